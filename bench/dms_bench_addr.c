@@ -0,0 +1,176 @@
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../src/dms.h"
+
+// Per-chunk overhead of le() for tiny reads that never leave the process:
+// 8-byte reads of blocks we own and of remote blocks already in the cache,
+// and the address arithmetic of one chunk on its own. Process 0 measures
+// while the other simulated processes (loopback threads) only serve its
+// initial fetches. Comparing a power-of-two -t/-n with one that is not shows
+// the cost of the division-based fallback.
+
+#define NUM_POSITIONS 4096
+
+typedef struct {
+    int n, k, t;
+    long ops;
+} bench_options_t;
+
+static bench_options_t options = {4, 64, 1024, 5000000};
+static int measuring_done = 0;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Random 8-byte aligned positions in blocks owned (or not) by process 0
+static int pick_positions(int *positions, int owned, unsigned *seed) {
+    int count = 0;
+    for (int tries = 0; count < NUM_POSITIONS && tries < 100 * NUM_POSITIONS; tries++) {
+        int block = rand_r(seed) % options.k;
+        if ((get_block_owner(block) == 0) != owned) {
+            continue;
+        }
+        int offset = (rand_r(seed) % (options.t / 8)) * 8;
+        positions[count++] = block * options.t + offset;
+    }
+    return count;
+}
+
+static double time_reads(const int *positions, int count) {
+    uint64_t value, sum = 0;
+    double start = now_seconds();
+    for (long op = 0, i = 0; op < options.ops; op++) {
+        le(positions[i], (byte *)&value, sizeof(value));
+        sum += value;
+        if (++i == count) i = 0;
+    }
+    double elapsed = now_seconds() - start;
+    if (sum == 1) {
+        printf("\n");  // keeps the reads from being optimized away
+    }
+    return elapsed * 1e9 / options.ops;
+}
+
+// Block, offset, owner and storage address, as le() computes them per chunk
+static double time_arithmetic(const int *positions, int count) {
+    uintptr_t sum = 0;
+    double start = now_seconds();
+    for (long op = 0, i = 0; op < options.ops; op++) {
+        int position = positions[i];
+        int block_id = dms_block_of(position);
+        sum += dms_offset_of(position) + dms_owner_of(block_id);
+        sum += (uintptr_t)dms_owned_data_of(block_id);
+        if (++i == count) i = 0;
+    }
+    double elapsed = now_seconds() - start;
+    if (sum == 1) {
+        printf("\n");
+    }
+    return elapsed * 1e9 / options.ops;
+}
+
+static void *worker_main(void *arg) {
+    int pid = (int)(intptr_t)arg;
+    dms_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.n = options.n;
+    config.k = options.k;
+    config.t = options.t;
+    config.process_id = pid;
+    config.transport = DMS_TRANSPORT_LOOPBACK;
+    config.batch = DMS_BATCH_DEFAULT;
+
+    if (dms_init(&config) != DMS_SUCCESS) {
+        fprintf(stderr, "Process %d: dms_init failed\n", pid);
+        exit(1);
+    }
+
+    if (pid == 0) {
+        int *local = malloc(NUM_POSITIONS * sizeof(int));
+        int *remote = malloc(NUM_POSITIONS * sizeof(int));
+        unsigned seed = 1;
+        int num_local = pick_positions(local, 1, &seed);
+        int num_remote = pick_positions(remote, 0, &seed);
+
+        // Bring every remote block into the cache once
+        byte warm;
+        for (int i = 0; i < num_remote; i++) {
+            le(remote[i], &warm, 1);
+        }
+
+        double local_ns = num_local ? time_reads(local, num_local) : 0;
+        double remote_ns = num_remote ? time_reads(remote, num_remote) : 0;
+        double arithmetic_ns = num_remote ? time_arithmetic(remote, num_remote) : 0;
+        printf("addr n=%d k=%d t=%d (%s): 8-byte le() %.1f ns on owned blocks, %.1f ns on cached remote blocks, "
+               "%.2f ns of address arithmetic per chunk\n",
+               options.n, options.k, options.t,
+               dms_ctx->t_shift >= 0 && dms_ctx->n_shift >= 0 ? "shifts" : "divisions",
+               local_ns, remote_ns, arithmetic_ns);
+
+        free(local);
+        free(remote);
+        __atomic_store_n(&measuring_done, 1, __ATOMIC_RELEASE);
+    }
+
+    // Nothing arrives once process 0 has its blocks, so stay off its CPU
+    while (!__atomic_load_n(&measuring_done, __ATOMIC_ACQUIRE)) {
+        handle_incoming_messages();
+        usleep(1000);
+    }
+
+    dms_cleanup();
+    return NULL;
+}
+
+static void usage(const char *program_name) {
+    printf("Usage: %s [options]\n", program_name);
+    printf("  -n <num>   Simulated processes (threads) (default: 4)\n");
+    printf("  -k <num>   Number of blocks, at most %d stay cached (default: 64)\n", CACHE_SIZE);
+    printf("  -t <num>   Block size in bytes, a multiple of 8 (default: 1024)\n");
+    printf("  -o <num>   Reads per measurement (default: 5000000)\n");
+}
+
+int main(int argc, char *argv[]) {
+    int opt;
+    while ((opt = getopt(argc, argv, "n:k:t:o:h")) != -1) {
+        switch (opt) {
+            case 'n': options.n = atoi(optarg); break;
+            case 'k': options.k = atoi(optarg); break;
+            case 't': options.t = atoi(optarg); break;
+            case 'o': options.ops = atol(optarg); break;
+            default: usage(argv[0]); return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (options.t < 8 || options.t % 8 != 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    dms_debug = 0;
+    if (dms_loopback_create(options.n) != DMS_SUCCESS) {
+        fprintf(stderr, "Error: cannot create loopback fabric\n");
+        return 1;
+    }
+
+    pthread_t *threads = calloc(options.n, sizeof(pthread_t));
+    for (int i = 0; i < options.n; i++) {
+        pthread_create(&threads[i], NULL, worker_main, (void *)(intptr_t)i);
+    }
+    for (int i = 0; i < options.n; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+
+    dms_loopback_destroy();
+    return 0;
+}
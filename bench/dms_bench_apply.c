@@ -0,0 +1,152 @@
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../src/dms.h"
+
+// Sum of every int64 in the shared memory, computed by process 0 once by
+// reading the whole range with le() and once with dms_apply(), with a cold
+// cache each time. Every simulated process (loopback thread) fills the
+// blocks it owns with non-zero values first, so read responses are not
+// elided.
+
+typedef struct {
+    int n, k, t;
+    int passes;
+} bench_options_t;
+
+static bench_options_t options = {4, 4096, 4096, 5};
+static int measuring_done = 0;
+static uint64_t response_bytes = 0;  // read response bytes sent by all processes
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int64_t sum_with_reads(byte *buffer) {
+    int64_t sum = 0;
+    for (int block = 0; block < options.k; block++) {
+        le(block * options.t, buffer, options.t);
+        for (int i = 0; i < options.t; i += 8) {
+            int64_t value;
+            memcpy(&value, buffer + i, sizeof(value));
+            sum += value;
+        }
+    }
+    return sum;
+}
+
+static void *worker_main(void *arg) {
+    int pid = (int)(intptr_t)arg;
+    dms_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.n = options.n;
+    config.k = options.k;
+    config.t = options.t;
+    config.process_id = pid;
+    config.transport = DMS_TRANSPORT_LOOPBACK;
+    config.batch = DMS_BATCH_DEFAULT;
+
+    if (dms_init(&config) != DMS_SUCCESS) {
+        fprintf(stderr, "Process %d: dms_init failed\n", pid);
+        exit(1);
+    }
+
+    for (int block = pid; block < options.k; block += options.n) {
+        int64_t *data = (int64_t *)get_local_block_data(block);
+        for (int i = 0; i < options.t / 8; i++) {
+            data[i] = (int64_t)block * options.t + i + 1;
+        }
+    }
+    dms_barrier();
+
+    if (pid == 0) {
+        byte *buffer = malloc(options.t);
+        int total = options.k * options.t;
+        double read_time = 0, apply_time = 0;
+        int64_t read_sum = 0, apply_sum = 0;
+        for (int pass = 0; pass < options.passes; pass++) {
+            dms_flush_local_cache();
+            double start = now_seconds();
+            read_sum = sum_with_reads(buffer);
+            read_time += now_seconds() - start;
+
+            dms_flush_local_cache();
+            start = now_seconds();
+            dms_apply(0, total, DMS_APPLY_SUM, 0, &apply_sum);
+            apply_time += now_seconds() - start;
+        }
+
+        printf("apply n=%d k=%d t=%d (%.1f MB): le() scan %.2f ms, dms_apply() %.3f ms (%.0fx), sums %s\n",
+               options.n, options.k, options.t, total / (1024.0 * 1024.0),
+               read_time * 1e3 / options.passes, apply_time * 1e3 / options.passes,
+               read_time / apply_time, read_sum == apply_sum ? "match" : "DIFFER");
+
+        free(buffer);
+        __atomic_store_n(&measuring_done, 1, __ATOMIC_RELEASE);
+    }
+
+    while (!__atomic_load_n(&measuring_done, __ATOMIC_ACQUIRE)) {
+        handle_incoming_messages();
+        sched_yield();
+    }
+
+    __atomic_fetch_add(&response_bytes, dms_ctx->payload_bytes_sent, __ATOMIC_RELAXED);
+    dms_cleanup();
+    return NULL;
+}
+
+static void usage(const char *program_name) {
+    printf("Usage: %s [options]\n", program_name);
+    printf("  -n <num>   Simulated processes (threads) (default: 4)\n");
+    printf("  -k <num>   Number of blocks (default: 4096)\n");
+    printf("  -t <num>   Block size in bytes, a multiple of 8 (default: 4096)\n");
+    printf("  -p <num>   Passes per measurement (default: 5)\n");
+}
+
+int main(int argc, char *argv[]) {
+    int opt;
+    while ((opt = getopt(argc, argv, "n:k:t:p:h")) != -1) {
+        switch (opt) {
+            case 'n': options.n = atoi(optarg); break;
+            case 'k': options.k = atoi(optarg); break;
+            case 't': options.t = atoi(optarg); break;
+            case 'p': options.passes = atoi(optarg); break;
+            default: usage(argv[0]); return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (options.t < 8 || options.t % 8 != 0 || options.passes <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    dms_debug = 0;
+    if (dms_loopback_create(options.n) != DMS_SUCCESS) {
+        fprintf(stderr, "Error: cannot create loopback fabric\n");
+        return 1;
+    }
+
+    pthread_t *threads = calloc(options.n, sizeof(pthread_t));
+    for (int i = 0; i < options.n; i++) {
+        pthread_create(&threads[i], NULL, worker_main, (void *)(intptr_t)i);
+    }
+    for (int i = 0; i < options.n; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+
+    // dms_apply() sends no read responses, only one partial result per owner
+    printf("read responses: %.1f MB sent for %d le() scans; dms_apply() exchanges %d requests and %d results per call\n",
+           response_bytes / (1024.0 * 1024.0), options.passes, options.n - 1, options.n - 1);
+
+    dms_loopback_destroy();
+    return 0;
+}
@@ -0,0 +1,179 @@
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../src/dms.h"
+
+// Process 0 copies the first half of the shared memory onto the second
+// half, shifted by one and a half blocks so that source and destination
+// blocks have different owners: once through its own buffer with le() and
+// escreve() per block and once with dms_copy(). Then it fills the
+// destination with escreve() and with dms_fill(). Every simulated process (loopback thread) fills the blocks it
+// owns first. The destination is checked against the source after each
+// copy.
+
+typedef struct {
+    int n, k, t;
+    int passes;
+} bench_options_t;
+
+static bench_options_t options = {4, 4096, 4096, 3};
+static int measuring_done = 0;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void copy_through_caller(int destination, int size, byte *buffer) {
+    for (int position = 0; position < size; position += options.t) {
+        int chunk = size - position < options.t ? size - position : options.t;
+        le(position, buffer, chunk);
+        escreve(destination + position, buffer, chunk);
+    }
+}
+
+static void fill_through_caller(int destination, int size, byte *buffer) {
+    memset(buffer, 0x77, options.t);
+    for (int position = 0; position < size; position += options.t) {
+        int chunk = size - position < options.t ? size - position : options.t;
+        escreve(destination + position, buffer, chunk);
+    }
+}
+
+static int copy_matches(int destination, int size, byte *a, byte *b) {
+    for (int position = 0; position < size; position += options.t) {
+        int chunk = size - position < options.t ? size - position : options.t;
+        le(position, a, chunk);
+        le(destination + position, b, chunk);
+        if (memcmp(a, b, chunk) != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void *worker_main(void *arg) {
+    int pid = (int)(intptr_t)arg;
+    dms_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.n = options.n;
+    config.k = options.k;
+    config.t = options.t;
+    config.process_id = pid;
+    config.transport = DMS_TRANSPORT_LOOPBACK;
+    config.batch = DMS_BATCH_DEFAULT;
+
+    if (dms_init(&config) != DMS_SUCCESS) {
+        fprintf(stderr, "Process %d: dms_init failed\n", pid);
+        exit(1);
+    }
+
+    for (int block = pid; block < options.k / 2; block += options.n) {
+        byte *data = get_local_block_data(block);
+        for (int i = 0; i < options.t; i++) {
+            data[i] = (byte)(block * 31 + i);
+        }
+    }
+    dms_barrier();
+
+    if (pid == 0) {
+        byte *buffer = malloc(options.t);
+        byte *other = malloc(options.t);
+        int half = options.k / 2 * options.t;
+        int destination = half + options.t + options.t / 2;
+        int size = half - 2 * options.t;
+        double times[4] = {0};
+        int copies_match = 1;
+        for (int pass = 0; pass < options.passes; pass++) {
+            double start = now_seconds();
+            copy_through_caller(destination, size, buffer);
+            times[0] += now_seconds() - start;
+            copies_match &= copy_matches(destination, size, buffer, other);
+            dms_fill(destination, 0, size);
+
+            start = now_seconds();
+            dms_copy(destination, 0, size);
+            times[1] += now_seconds() - start;
+            copies_match &= copy_matches(destination, size, buffer, other);
+
+            start = now_seconds();
+            fill_through_caller(destination, size, buffer);
+            times[2] += now_seconds() - start;
+
+            start = now_seconds();
+            dms_fill(destination, 0x77, size);
+            times[3] += now_seconds() - start;
+        }
+
+        for (int i = 0; i < 4; i++) {
+            times[i] *= 1e3 / options.passes;
+        }
+        printf("copy n=%d k=%d t=%d (%.1f MB): le()+escreve() %.2f ms, dms_copy() %.2f ms (%.1fx), copies %s; "
+               "escreve() fill %.2f ms, dms_fill() %.2f ms (%.1fx)\n",
+               options.n, options.k, options.t, size / (1024.0 * 1024.0), times[0], times[1],
+               times[0] / times[1], copies_match ? "match" : "DIFFER", times[2], times[3], times[2] / times[3]);
+
+        free(buffer);
+        free(other);
+        __atomic_store_n(&measuring_done, 1, __ATOMIC_RELEASE);
+    }
+
+    while (!__atomic_load_n(&measuring_done, __ATOMIC_ACQUIRE)) {
+        handle_incoming_messages();
+        sched_yield();
+    }
+
+    dms_cleanup();
+    return NULL;
+}
+
+static void usage(const char *program_name) {
+    printf("Usage: %s [options]\n", program_name);
+    printf("  -n <num>   Simulated processes (threads) (default: 4)\n");
+    printf("  -k <num>   Number of blocks, half copied onto the other half (default: 4096)\n");
+    printf("  -t <num>   Block size in bytes (default: 4096)\n");
+    printf("  -p <num>   Passes per measurement (default: 3)\n");
+}
+
+int main(int argc, char *argv[]) {
+    int opt;
+    while ((opt = getopt(argc, argv, "n:k:t:p:h")) != -1) {
+        switch (opt) {
+            case 'n': options.n = atoi(optarg); break;
+            case 'k': options.k = atoi(optarg); break;
+            case 't': options.t = atoi(optarg); break;
+            case 'p': options.passes = atoi(optarg); break;
+            default: usage(argv[0]); return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (options.k < 8 || options.t <= 0 || options.passes <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    dms_debug = 0;
+    if (dms_loopback_create(options.n) != DMS_SUCCESS) {
+        fprintf(stderr, "Error: cannot create loopback fabric\n");
+        return 1;
+    }
+
+    pthread_t *threads = calloc(options.n, sizeof(pthread_t));
+    for (int i = 0; i < options.n; i++) {
+        pthread_create(&threads[i], NULL, worker_main, (void *)(intptr_t)i);
+    }
+    for (int i = 0; i < options.n; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+
+    dms_loopback_destroy();
+    return 0;
+}
@@ -0,0 +1,159 @@
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../src/dms.h"
+
+// Random small records scattered over remote blocks, read with a loop of
+// le() calls and then with one le_v() call, and written with a loop of
+// escreve() calls and with one escreve_v() call. Process 0 measures with a
+// cold cache for every pass; the other simulated processes (loopback
+// threads) serve its requests.
+
+typedef struct {
+    int n, k, t;
+    int records, size;
+    int passes;
+} bench_options_t;
+
+static bench_options_t options = {4, 4096, 1024, 1000, 8, 20};
+static int measuring_done = 0;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Positions of records that fit in one block not owned by process 0
+static void pick_records(dms_iovec_t *records, byte *buffers, unsigned *seed) {
+    for (int i = 0; i < options.records; i++) {
+        int block;
+        do {
+            block = rand_r(seed) % options.k;
+        } while (get_block_owner(block) == 0);
+        int offset = rand_r(seed) % (options.t - options.size + 1);
+        records[i].posicao = block * options.t + offset;
+        records[i].buffer = buffers + (size_t)i * options.size;
+        records[i].tamanho = options.size;
+    }
+}
+
+// Microseconds per pass
+static double time_passes(const dms_iovec_t *records, int vectored, int write) {
+    double total = 0;
+    for (int pass = 0; pass < options.passes; pass++) {
+        dms_flush_local_cache();
+        double start = now_seconds();
+        if (vectored) {
+            write ? escreve_v(records, options.records) : le_v(records, options.records);
+        } else {
+            for (int i = 0; i < options.records; i++) {
+                write ? escreve(records[i].posicao, records[i].buffer, records[i].tamanho)
+                      : le(records[i].posicao, records[i].buffer, records[i].tamanho);
+            }
+        }
+        total += now_seconds() - start;
+    }
+    return total * 1e6 / options.passes;
+}
+
+static void *worker_main(void *arg) {
+    int pid = (int)(intptr_t)arg;
+    dms_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.n = options.n;
+    config.k = options.k;
+    config.t = options.t;
+    config.process_id = pid;
+    config.transport = DMS_TRANSPORT_LOOPBACK;
+    config.batch = DMS_BATCH_DEFAULT;
+
+    if (dms_init(&config) != DMS_SUCCESS) {
+        fprintf(stderr, "Process %d: dms_init failed\n", pid);
+        exit(1);
+    }
+
+    if (pid == 0) {
+        dms_iovec_t *records = malloc(options.records * sizeof(dms_iovec_t));
+        byte *buffers = calloc(options.records, options.size);
+        unsigned seed = 1;
+        pick_records(records, buffers, &seed);
+
+        double read_scalar = time_passes(records, 0, 0);
+        double read_vectored = time_passes(records, 1, 0);
+        double write_scalar = time_passes(records, 0, 1);
+        double write_vectored = time_passes(records, 1, 1);
+        printf("gather n=%d k=%d t=%d, %d records of %d bytes: read %.0f us with le(), %.0f us with le_v() (%.1fx); "
+               "write %.0f us with escreve(), %.0f us with escreve_v() (%.1fx)\n",
+               options.n, options.k, options.t, options.records, options.size,
+               read_scalar, read_vectored, read_scalar / read_vectored,
+               write_scalar, write_vectored, write_scalar / write_vectored);
+
+        free(records);
+        free(buffers);
+        __atomic_store_n(&measuring_done, 1, __ATOMIC_RELEASE);
+    }
+
+    while (!__atomic_load_n(&measuring_done, __ATOMIC_ACQUIRE)) {
+        handle_incoming_messages();
+        sched_yield();
+    }
+
+    dms_cleanup();
+    return NULL;
+}
+
+static void usage(const char *program_name) {
+    printf("Usage: %s [options]\n", program_name);
+    printf("  -n <num>   Simulated processes (threads) (default: 4)\n");
+    printf("  -k <num>   Number of blocks (default: 4096)\n");
+    printf("  -t <num>   Block size in bytes (default: 1024)\n");
+    printf("  -r <num>   Records per pass (default: 1000)\n");
+    printf("  -z <num>   Record size in bytes, at most -t (default: 8)\n");
+    printf("  -p <num>   Passes per measurement (default: 20)\n");
+}
+
+int main(int argc, char *argv[]) {
+    int opt;
+    while ((opt = getopt(argc, argv, "n:k:t:r:z:p:h")) != -1) {
+        switch (opt) {
+            case 'n': options.n = atoi(optarg); break;
+            case 'k': options.k = atoi(optarg); break;
+            case 't': options.t = atoi(optarg); break;
+            case 'r': options.records = atoi(optarg); break;
+            case 'z': options.size = atoi(optarg); break;
+            case 'p': options.passes = atoi(optarg); break;
+            default: usage(argv[0]); return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (options.n < 2 || options.size <= 0 || options.size > options.t ||
+        options.records <= 0 || options.passes <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    dms_debug = 0;
+    if (dms_loopback_create(options.n) != DMS_SUCCESS) {
+        fprintf(stderr, "Error: cannot create loopback fabric\n");
+        return 1;
+    }
+
+    pthread_t *threads = calloc(options.n, sizeof(pthread_t));
+    for (int i = 0; i < options.n; i++) {
+        pthread_create(&threads[i], NULL, worker_main, (void *)(intptr_t)i);
+    }
+    for (int i = 0; i < options.n; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+
+    dms_loopback_destroy();
+    return 0;
+}
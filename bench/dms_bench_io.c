@@ -0,0 +1,146 @@
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../src/dms.h"
+
+// Bandwidth of dms_checkpoint() and dms_load(), where every process moves
+// only the blocks it owns, against loading the same file through a single
+// writer: process 0 reads it and calls escreve() block by block while the
+// others serve the writes. Unlike the other benchmarks this one runs under
+// MPI, one process per rank:
+//
+//   mpirun -np 4 ./bench/dms_bench_io -k 2048 -t 4096
+
+typedef struct {
+    int k, t;
+    int passes;
+    const char *path;
+} bench_options_t;
+
+static bench_options_t options = {2048, 4096, 3, "dms_bench_io.bin"};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static byte pattern_of(int block_id, int i) {
+    return (byte)(block_id * 131 + i);
+}
+
+static double load_through_one_writer(void) {
+    double start = now_seconds();
+    if (dms_ctx->config.process_id == 0) {
+        int fd = open(options.path, O_RDONLY);
+        byte *buffer = malloc(options.t);
+        for (int block_id = 0; fd >= 0 && block_id < options.k; block_id++) {
+            if (pread(fd, buffer, options.t, (off_t)block_id * options.t) != options.t) {
+                break;
+            }
+            escreve(block_id * options.t, buffer, options.t);
+        }
+        free(buffer);
+        if (fd >= 0) close(fd);
+    }
+    dms_barrier();  // the others serve the writes meanwhile
+    return now_seconds() - start;
+}
+
+static void usage(const char *program_name) {
+    printf("Usage: mpirun -np <n> %s [options]\n", program_name);
+    printf("  -k <num>   Number of blocks (default: 2048)\n");
+    printf("  -t <num>   Block size in bytes (default: 4096)\n");
+    printf("  -p <num>   Passes per measurement (default: 3)\n");
+    printf("  -f <path>  File, visible to every rank (default: dms_bench_io.bin)\n");
+}
+
+int main(int argc, char *argv[]) {
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    int opt;
+    while ((opt = getopt(argc, argv, "k:t:p:f:h")) != -1) {
+        switch (opt) {
+            case 'k': options.k = atoi(optarg); break;
+            case 't': options.t = atoi(optarg); break;
+            case 'p': options.passes = atoi(optarg); break;
+            case 'f': options.path = optarg; break;
+            default:
+                if (rank == 0) usage(argv[0]);
+                MPI_Finalize();
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    dms_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.n = size;
+    config.k = options.k;
+    config.t = options.t;
+    config.process_id = rank;
+    config.transport = DMS_TRANSPORT_MESSAGE;
+    config.batch = DMS_BATCH_DEFAULT;
+
+    dms_debug = 0;
+    if (dms_init(&config) != DMS_SUCCESS) {
+        fprintf(stderr, "Process %d: dms_init failed\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    for (int block_id = rank; block_id < options.k; block_id += size) {
+        byte *data = get_local_block_data(block_id);
+        for (int i = 0; i < options.t; i++) {
+            data[i] = pattern_of(block_id, i);
+        }
+    }
+
+    double save_time = 0, load_time = 0, single_time = 0;
+    int errors = 0;
+    for (int pass = 0; pass < options.passes; pass++) {
+        double start = now_seconds();
+        errors += dms_checkpoint(options.path) != DMS_SUCCESS;
+        save_time += now_seconds() - start;
+
+        start = now_seconds();
+        errors += dms_load(options.path) != DMS_SUCCESS;
+        load_time += now_seconds() - start;
+
+        single_time += load_through_one_writer();
+    }
+
+    for (int block_id = rank; block_id < options.k; block_id += size) {
+        byte *data = get_local_block_data(block_id);
+        for (int i = 0; i < options.t; i++) {
+            errors += data[i] != pattern_of(block_id, i);
+        }
+    }
+    int total_errors = 0;
+    MPI_Reduce(&errors, &total_errors, 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
+
+    if (rank == 0) {
+        double megabytes = (double)options.k * options.t / (1024.0 * 1024.0);
+        save_time /= options.passes;
+        load_time /= options.passes;
+        single_time /= options.passes;
+        printf("io n=%d k=%d t=%d (%.1f MB): dms_checkpoint %.1f ms (%.0f MB/s), dms_load %.1f ms (%.0f MB/s), "
+               "one writer %.1f ms (%.0f MB/s), %s\n",
+               size, options.k, options.t, megabytes, save_time * 1e3, megabytes / save_time,
+               load_time * 1e3, megabytes / load_time, single_time * 1e3, megabytes / single_time,
+               total_errors ? "ERRORS" : "contents verified");
+        unlink(options.path);
+    }
+
+    dms_cleanup();
+    MPI_Finalize();
+    return total_errors ? 1 : 0;
+}
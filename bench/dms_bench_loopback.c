@@ -0,0 +1,340 @@
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../src/dms.h"
+
+// Drives the coherence protocol with every simulated process running as a
+// thread over the loopback transport, without mpirun.
+//
+//   bench mode (default): random le()/escreve() of 8-byte slots, reports ops/s
+//   fuzz mode (-f):       every slot has a single writer; each process checks
+//                         that it reads back its own last write and that the
+//                         values it sees from other writers never go back
+//   atomics (-a):         a share of the operations are dms_fetch_add() on
+//                         counters in the last block; their final sum must
+//                         match the number of successful increments
+//   locks (-l):           a share of the operations increment a counter in
+//                         the last block inside dms_lock()/dms_unlock(); no
+//                         increment may be lost
+//   release (-r N):       release consistency, each process calls
+//                         dms_release() and dms_acquire() every N operations
+//   mapped (-M):          slots are loaded and stored through dms_map()
+//                         instead of le()/escreve(); needs -r and -t 4096
+
+typedef struct {
+    int n, k, t;
+    long ops;
+    int write_percent;
+    int atomic_percent;
+    int lock_percent;
+    int fuzz;
+    int batch;
+    int sector;
+    int compress;
+    int release_interval;
+    int map;
+    unsigned seed;
+} bench_options_t;
+
+typedef struct {
+    int pid;
+    pthread_t thread;
+    long errors;
+    long reads, writes, increments, locked;
+    uint64_t payload_bytes, payload_bytes_sent;
+    double seconds;
+} worker_t;
+
+static bench_options_t options = {4, 64, 1024, 20000, 20, 0, 0, 0, DMS_BATCH_DEFAULT, 0, 0, 0, 0, 1};
+#define NUM_COUNTERS 8
+#define NUM_LOCKS 4  // lock i protects the counter after the atomic ones
+
+static int workers_done = 0;
+static int counters_checked = 0;
+static int64_t counters_total = 0;
+static int64_t locked_total = 0;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *worker_main(void *arg) {
+    worker_t *worker = arg;
+    dms_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.n = options.n;
+    config.k = options.k;
+    config.t = options.t;
+    config.process_id = worker->pid;
+    config.transport = DMS_TRANSPORT_LOOPBACK;
+    config.batch = options.batch;
+    config.sector = options.sector;
+    config.compress = options.compress;
+    config.coherence = options.release_interval > 0 ? DMS_COHERENCE_RELEASE : DMS_COHERENCE_STRICT;
+    config.map = options.map;
+
+    byte *base = NULL;
+    if (dms_init(&config) != DMS_SUCCESS || (options.map && dms_map(&base) != DMS_SUCCESS)) {
+        fprintf(stderr, "Process %d: dms_init failed\n", worker->pid);
+        worker->errors++;
+        __atomic_add_fetch(&workers_done, 1, __ATOMIC_RELEASE);
+        return NULL;
+    }
+
+    // With atomics or locks on, the last block holds the counters
+    int counters = options.atomic_percent > 0 || options.lock_percent > 0;
+    int data_blocks = counters ? options.k - 1 : options.k;
+    int counters_position = data_blocks * options.t;
+    int slots = data_blocks * options.t / (int)sizeof(uint64_t);
+    uint64_t *last_seen = calloc(slots, sizeof(uint64_t));
+    uint64_t counter = 0;
+    unsigned seed = options.seed * 7919u + worker->pid;
+
+    double start = now_seconds();
+    for (long op = 0; op < options.ops; op++) {
+        if (options.release_interval > 0 && op % options.release_interval == 0) {
+            if (dms_release() != DMS_SUCCESS || dms_acquire() != DMS_SUCCESS) {
+                fprintf(stderr, "Process %d: release/acquire failed\n", worker->pid);
+                worker->errors++;
+            }
+        }
+
+        if ((int)(rand_r(&seed) % 100) < options.atomic_percent) {
+            int counter_id = rand_r(&seed) % NUM_COUNTERS;
+            int result = dms_fetch_add(counters_position + counter_id * (int)sizeof(int64_t),
+                                       sizeof(int64_t), 1, NULL);
+            if (result == DMS_SUCCESS) {
+                worker->increments++;
+            } else {
+                fprintf(stderr, "Process %d: fetch_add failed with %d\n", worker->pid, result);
+                worker->errors++;
+            }
+            continue;
+        }
+
+        if ((int)(rand_r(&seed) % 100) < options.lock_percent) {
+            int lock_id = rand_r(&seed) % NUM_LOCKS;
+            int position = counters_position + (NUM_COUNTERS + lock_id) * (int)sizeof(int64_t);
+            int64_t value = 0;
+            int result = dms_lock(lock_id);
+            if (result == DMS_SUCCESS) {
+                result = le(position, (byte *)&value, sizeof(value));
+            }
+            if (result == DMS_SUCCESS) {
+                value++;
+                result = escreve(position, (byte *)&value, sizeof(value));
+            }
+            if (result == DMS_SUCCESS) {
+                result = dms_unlock(lock_id);
+            }
+            if (result == DMS_SUCCESS) {
+                worker->locked++;
+            } else {
+                fprintf(stderr, "Process %d: locked increment failed with %d\n", worker->pid, result);
+                worker->errors++;
+            }
+            continue;
+        }
+
+        int slot = rand_r(&seed) % slots;
+        int is_write = (int)(rand_r(&seed) % 100) < options.write_percent;
+
+        if (options.fuzz && is_write) {
+            // Only the slot's designated writer may write it
+            slot -= slot % options.n;
+            slot += worker->pid;
+            if (slot >= slots) {
+                continue;
+            }
+        }
+
+        uint64_t value;
+        int result = DMS_SUCCESS;
+        if (is_write) {
+            value = ((uint64_t)worker->pid << 48) | ++counter;
+            if (base) {
+                memcpy(base + slot * sizeof(uint64_t), &value, sizeof(value));
+            } else {
+                result = escreve(slot * (int)sizeof(uint64_t), (byte *)&value, sizeof(value));
+            }
+            if (result == DMS_SUCCESS) {
+                last_seen[slot] = value;
+            }
+            worker->writes++;
+        } else {
+            if (base) {
+                memcpy(&value, base + slot * sizeof(uint64_t), sizeof(value));
+            } else {
+                result = le(slot * (int)sizeof(uint64_t), (byte *)&value, sizeof(value));
+            }
+            worker->reads++;
+            if (result == DMS_SUCCESS && options.fuzz && value != 0) {
+                int writer = (int)(value >> 48);
+                if (writer != slot % options.n) {
+                    fprintf(stderr, "Process %d: slot %d holds a value from process %d\n",
+                            worker->pid, slot, writer);
+                    worker->errors++;
+                } else if (writer == worker->pid && value != last_seen[slot]) {
+                    fprintf(stderr, "Process %d: slot %d lost our write\n", worker->pid, slot);
+                    worker->errors++;
+                } else if (value < last_seen[slot]) {
+                    fprintf(stderr, "Process %d: slot %d went back in time\n", worker->pid, slot);
+                    worker->errors++;
+                } else {
+                    last_seen[slot] = value;
+                }
+            }
+        }
+
+        if (result != DMS_SUCCESS) {
+            fprintf(stderr, "Process %d: operation failed with %d\n", worker->pid, result);
+            worker->errors++;
+        }
+    }
+    if (dms_release() != DMS_SUCCESS) {
+        worker->errors++;
+    }
+    worker->seconds = now_seconds() - start;
+
+    // Keep serving the others until everybody is finished
+    __atomic_add_fetch(&workers_done, 1, __ATOMIC_RELEASE);
+    while (__atomic_load_n(&workers_done, __ATOMIC_ACQUIRE) < options.n) {
+        handle_incoming_messages();
+        sched_yield();
+    }
+
+    // Process 0 sums the counters while the others keep serving
+    if (worker->pid == 0 && counters) {
+        dms_acquire();  // our cached copy may predate the last increments
+        int64_t total = 0;
+        for (int i = 0; i < NUM_COUNTERS; i++) {
+            int64_t value = 0;
+            le(counters_position + i * (int)sizeof(int64_t), (byte *)&value, sizeof(value));
+            total += value;
+        }
+        int64_t locked = 0;
+        for (int i = 0; i < NUM_LOCKS && options.lock_percent > 0; i++) {
+            int64_t value = 0;
+            dms_lock(i);
+            le(counters_position + (NUM_COUNTERS + i) * (int)sizeof(int64_t), (byte *)&value, sizeof(value));
+            dms_unlock(i);
+            locked += value;
+        }
+        __atomic_store_n(&counters_total, total, __ATOMIC_RELEASE);
+        __atomic_store_n(&locked_total, locked, __ATOMIC_RELEASE);
+        __atomic_store_n(&counters_checked, 1, __ATOMIC_RELEASE);
+    }
+    while (counters && !__atomic_load_n(&counters_checked, __ATOMIC_ACQUIRE)) {
+        handle_incoming_messages();
+        sched_yield();
+    }
+
+    worker->payload_bytes = dms_ctx->payload_bytes;
+    worker->payload_bytes_sent = dms_ctx->payload_bytes_sent;
+    free(last_seen);
+    dms_cleanup();
+    return NULL;
+}
+
+static void usage(const char *program_name) {
+    printf("Usage: %s [options]\n", program_name);
+    printf("  -n <num>   Simulated processes (threads) (default: 4)\n");
+    printf("  -k <num>   Number of blocks (default: 64)\n");
+    printf("  -t <num>   Block size in bytes (default: 1024)\n");
+    printf("  -o <num>   Operations per process (default: 20000)\n");
+    printf("  -w <pct>   Percentage of writes (default: 20)\n");
+    printf("  -a <pct>   Percentage of dms_fetch_add() on shared counters (default: 0)\n");
+    printf("  -l <pct>   Percentage of counter increments under dms_lock() (default: 0)\n");
+    printf("  -b <bytes> Message aggregation threshold, 0 disables (default: %d)\n", DMS_BATCH_DEFAULT);
+    printf("  -S <bytes> Cache sector size (default: whole block)\n");
+    printf("  -z <MB/s>  Link speed for adaptive RLE of read responses (default: off)\n");
+    printf("  -r <ops>   Release consistency, release/acquire every <ops> (default: off)\n");
+    printf("  -M         Access slots through dms_map() pointers (needs -r and -t 4096)\n");
+    printf("  -s <seed>  Random seed (default: 1)\n");
+    printf("  -f         Fuzz mode: verify coherence invariants\n");
+}
+
+int main(int argc, char *argv[]) {
+    int opt;
+    while ((opt = getopt(argc, argv, "n:k:t:o:w:a:l:b:S:z:r:s:Mfh")) != -1) {
+        switch (opt) {
+            case 'n': options.n = atoi(optarg); break;
+            case 'k': options.k = atoi(optarg); break;
+            case 't': options.t = atoi(optarg); break;
+            case 'o': options.ops = atol(optarg); break;
+            case 'w': options.write_percent = atoi(optarg); break;
+            case 'a': options.atomic_percent = atoi(optarg); break;
+            case 'l': options.lock_percent = atoi(optarg); break;
+            case 'b': options.batch = atoi(optarg); break;
+            case 'S': options.sector = atoi(optarg); break;
+            case 'z': options.compress = atoi(optarg); break;
+            case 'r': options.release_interval = atoi(optarg); break;
+            case 's': options.seed = (unsigned)atoi(optarg); break;
+            case 'M': options.map = 1; break;
+            case 'f': options.fuzz = 1; break;
+            default: usage(argv[0]); return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    dms_debug = 0;
+    if (dms_loopback_create(options.n) != DMS_SUCCESS) {
+        fprintf(stderr, "Error: cannot create loopback fabric\n");
+        return 1;
+    }
+
+    worker_t *workers = calloc(options.n, sizeof(worker_t));
+    for (int i = 0; i < options.n; i++) {
+        workers[i].pid = i;
+        pthread_create(&workers[i].thread, NULL, worker_main, &workers[i]);
+    }
+
+    long errors = 0, reads = 0, writes = 0, increments = 0, locked = 0;
+    uint64_t payload_bytes = 0, payload_bytes_sent = 0;
+    double slowest = 0;
+    for (int i = 0; i < options.n; i++) {
+        pthread_join(workers[i].thread, NULL);
+        errors += workers[i].errors;
+        reads += workers[i].reads;
+        writes += workers[i].writes;
+        increments += workers[i].increments;
+        locked += workers[i].locked;
+        payload_bytes += workers[i].payload_bytes;
+        payload_bytes_sent += workers[i].payload_bytes_sent;
+        if (workers[i].seconds > slowest) slowest = workers[i].seconds;
+    }
+
+    dms_loopback_destroy();
+
+    printf("loopback n=%d k=%d t=%d batch=%d: %ld reads, %ld writes, %ld atomics, %ld locked in %.3f s (%.0f ops/s)\n",
+           options.n, options.k, options.t, options.batch, reads, writes, increments, locked, slowest,
+           slowest > 0 ? (reads + writes + increments + locked) / slowest : 0.0);
+    printf("read responses: %llu bytes sent for %llu bytes of blocks\n",
+           (unsigned long long)payload_bytes_sent, (unsigned long long)payload_bytes);
+    if (options.atomic_percent > 0) {
+        printf("atomics: %ld increments, counters sum to %lld\n", increments, (long long)counters_total);
+        if (counters_total != increments) {
+            errors++;
+        }
+    }
+    if (options.lock_percent > 0) {
+        printf("locks: %ld increments, counters sum to %lld\n", locked, (long long)locked_total);
+        if (locked_total != locked) {
+            errors++;
+        }
+    }
+    if (options.fuzz) {
+        printf("fuzz: %ld violations\n", errors);
+    }
+
+    free(workers);
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,156 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../src/dms.h"
+
+// Cost of a strict-coherence write as the number of processes grows, run by
+// oversubscribing MPI ranks on one machine:
+//
+//   for n in 8 16 32 64; do mpirun --oversubscribe -np $n ./bench/dms_bench_scale; done
+//
+// Process 0 writes blocks of process 1 in two settings: "private" blocks
+// nobody else has read, and a "shared" block every process read just before
+// the write. Their owner invalidates only the sharers it recorded, through a
+// relay tree when there are many. Also reported: MSG_INVALIDATE messages sent
+// by all processes per write, and the per-process memory of the sharer
+// directory and of the aggregation buffers.
+
+typedef struct {
+    int k, t;
+    int rounds;
+} bench_options_t;
+
+static bench_options_t options = {4096, 1024, 20};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t total_invalidations(void) {
+    uint64_t mine = dms_ctx->invalidations_sent, total = 0;
+    MPI_Allreduce(&mine, &total, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+    return total;
+}
+
+// Blocks of process 1 (of process 0 when alone), one per round
+static int block_of_round(int round) {
+    int n = dms_ctx->config.n;
+    return (n > 1 ? 1 : 0) + (round + 1) * n;
+}
+
+static size_t state_bytes(void) {
+    int n = dms_ctx->config.n;
+    int me = dms_ctx->config.process_id;
+    size_t owned = (size_t)(dms_ctx->config.k / n + (me < dms_ctx->config.k % n));
+    size_t bytes = owned * sizeof(uint64_t);
+    dms_transport_state_t *transport = dms_ctx->transport;
+    if (transport->outbox) {
+        bytes += (size_t)n * (sizeof(dms_message_t *) + sizeof(int) * 2 + sizeof(uint64_t));
+        for (int i = 0; i < n; i++) {
+            if (transport->outbox[i]) {
+                bytes += offsetof(dms_message_t, data) + dms_ctx->config.batch;
+            }
+        }
+    }
+    return bytes;
+}
+
+int main(int argc, char *argv[]) {
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    int opt;
+    while ((opt = getopt(argc, argv, "k:t:r:h")) != -1) {
+        switch (opt) {
+            case 'k': options.k = atoi(optarg); break;
+            case 't': options.t = atoi(optarg); break;
+            case 'r': options.rounds = atoi(optarg); break;
+            default:
+                if (rank == 0) {
+                    printf("Usage: mpirun -np <n> %s [-k blocks] [-t block size] [-r rounds]\n", argv[0]);
+                }
+                MPI_Finalize();
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    dms_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.n = size;
+    config.k = options.k;
+    config.t = options.t;
+    config.process_id = rank;
+    config.transport = DMS_TRANSPORT_MESSAGE;
+    config.batch = DMS_BATCH_DEFAULT;
+
+    dms_debug = 0;
+    if (dms_init(&config) != DMS_SUCCESS ||
+        (int64_t)block_of_round(options.rounds) >= options.k) {
+        fprintf(stderr, "Process %d: dms_init failed or -k too small\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    byte value[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+    byte buffer[8];
+    dms_barrier();
+
+    // Private blocks: only the writer and the owner are involved
+    uint64_t before = total_invalidations();
+    double private_time = 0;
+    if (rank == 0) {
+        for (int round = 0; round < options.rounds; round++) {
+            double start = now_seconds();
+            escreve(block_of_round(round) * options.t, value, sizeof(value));
+            private_time += now_seconds() - start;
+        }
+    }
+    dms_barrier();
+    uint64_t private_invalidations = total_invalidations() - before;
+
+    // Shared block: everybody caches it before each write
+    before = total_invalidations();
+    double shared_time = 0;
+    int shared_position = block_of_round(0) * options.t;
+    for (int round = 0; round < options.rounds; round++) {
+        le(shared_position, buffer, sizeof(buffer));
+        dms_barrier();
+        if (rank == 0) {
+            value[0] = (byte)round;
+            double start = now_seconds();
+            escreve(shared_position, value, sizeof(value));
+            shared_time += now_seconds() - start;
+        }
+        dms_barrier();
+    }
+    uint64_t shared_invalidations = total_invalidations() - before;
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    long rss_kb = usage.ru_maxrss, max_rss_kb = 0;
+    long state = (long)state_bytes(), max_state = 0;
+    MPI_Reduce(&rss_kb, &max_rss_kb, 1, MPI_LONG, MPI_MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&state, &max_state, 1, MPI_LONG, MPI_MAX, 0, MPI_COMM_WORLD);
+
+    if (rank == 0) {
+        printf("scale n=%d k=%d t=%d: private write %.3f ms (%.1f invalidations), "
+               "shared write %.3f ms (%.1f invalidations), directory+outboxes %.1f KB, max RSS %.1f MB\n",
+               size, options.k, options.t, private_time * 1e3 / options.rounds,
+               (double)private_invalidations / options.rounds, shared_time * 1e3 / options.rounds,
+               (double)shared_invalidations / options.rounds, max_state / 1024.0, max_rss_kb / 1024.0);
+    }
+
+    dms_cleanup();
+    MPI_Finalize();
+    return 0;
+}
@@ -0,0 +1,129 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../src/dms.h"
+
+// Measures what dms_init() costs one process as the memory grows: the time
+// it takes and the resident set it leaves behind, then the resident set after
+// the process writes to some of the blocks it owns. Only process 0 of the
+// loopback fabric is started; owned blocks are written in place, so no other
+// process has to answer.
+
+typedef struct {
+    int n, t;
+    int touched;
+    int k_values[16];
+    int num_k;
+} bench_options_t;
+
+static bench_options_t options = {4, 4096, 100, {0}, 0};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Resident set size in bytes, from /proc/self/statm
+static long resident_bytes(void) {
+    FILE *file = fopen("/proc/self/statm", "r");
+    if (!file) {
+        return 0;
+    }
+    long size = 0, resident = 0;
+    if (fscanf(file, "%ld %ld", &size, &resident) != 2) {
+        resident = 0;
+    }
+    fclose(file);
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+static double megabytes(long bytes) {
+    return bytes / (1024.0 * 1024.0);
+}
+
+static int run(int k) {
+    dms_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.n = options.n;
+    config.k = k;
+    config.t = options.t;
+    config.process_id = 0;
+    config.transport = DMS_TRANSPORT_LOOPBACK;
+    config.batch = DMS_BATCH_DEFAULT;
+
+    long before = resident_bytes();
+    double start = now_seconds();
+    if (dms_init(&config) != DMS_SUCCESS) {
+        fprintf(stderr, "Error: dms_init failed for k=%d\n", k);
+        return 1;
+    }
+    double elapsed = now_seconds() - start;
+    long after_init = resident_bytes();
+
+    // Process 0 owns blocks 0, n, 2n, ...
+    int touched = 0;
+    for (int block = 0; block < k && touched < options.touched; block += options.n) {
+        memset(get_local_block_data(block), 0xA5, options.t);
+        touched++;
+    }
+    long after_touch = resident_bytes();
+
+    printf("k=%-8d t=%d: dms_init %8.3f ms, RSS +%8.2f MB after init, +%8.2f MB after writing %d blocks (%.2f MB owned)\n",
+           k, options.t, elapsed * 1e3, megabytes(after_init - before), megabytes(after_touch - before),
+           touched, megabytes((long)((k + options.n - 1) / options.n) * options.t));
+
+    dms_cleanup();
+    return 0;
+}
+
+static void usage(const char *program_name) {
+    printf("Usage: %s [options]\n", program_name);
+    printf("  -n <num>   Simulated processes, only process 0 runs (default: 4)\n");
+    printf("  -k <num>   Number of blocks, repeat to sweep (default: 1000 10000 100000 1000000)\n");
+    printf("  -t <num>   Block size in bytes (default: 4096)\n");
+    printf("  -w <num>   Owned blocks written after init (default: 100)\n");
+}
+
+int main(int argc, char *argv[]) {
+    int opt;
+    while ((opt = getopt(argc, argv, "n:k:t:w:h")) != -1) {
+        switch (opt) {
+            case 'n': options.n = atoi(optarg); break;
+            case 'k':
+                if (options.num_k < (int)(sizeof(options.k_values) / sizeof(options.k_values[0]))) {
+                    options.k_values[options.num_k++] = atoi(optarg);
+                }
+                break;
+            case 't': options.t = atoi(optarg); break;
+            case 'w': options.touched = atoi(optarg); break;
+            default: usage(argv[0]); return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    if (options.num_k == 0) {
+        int defaults[] = {1000, 10000, 100000, 1000000};
+        for (int i = 0; i < 4; i++) {
+            options.k_values[options.num_k++] = defaults[i];
+        }
+    }
+
+    dms_debug = 0;
+    if (dms_loopback_create(options.n) != DMS_SUCCESS) {
+        fprintf(stderr, "Error: cannot create loopback fabric\n");
+        return 1;
+    }
+
+    int errors = 0;
+    for (int i = 0; i < options.num_k; i++) {
+        errors += run(options.k_values[i]);
+    }
+
+    dms_loopback_destroy();
+    return errors ? 1 : 0;
+}
@@ -1,3 +1,5 @@
+#define _GNU_SOURCE
+
 #include "dms.h"
 
 #include <errno.h>
@@ -5,20 +7,109 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
-dms_context_t *dms_ctx = NULL;
+__thread dms_context_t *dms_ctx = NULL;
+int dms_debug = 1;
+
+// Owned blocks are reserved as demand-zero pages: nothing is touched at
+// startup and the kernel backs a page with memory on its first write. With
+// 'map' they live in a memory file instead, so that dms_map() can map the
+// same pages a second time at their place in the shared address range.
+static int map_local_storage(size_t size) {
+    dms_ctx->storage_fd = -1;
+    if (size == 0) {
+        return DMS_SUCCESS;
+    }
+
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE;
+    if (dms_ctx->config.map) {
+        dms_ctx->storage_fd = memfd_create("dms-blocks", MFD_CLOEXEC);
+        if (dms_ctx->storage_fd < 0 || ftruncate(dms_ctx->storage_fd, size) != 0) {
+            if (dms_ctx->storage_fd >= 0) {
+                close(dms_ctx->storage_fd);
+                dms_ctx->storage_fd = -1;
+            }
+            return DMS_ERROR_MEMORY;
+        }
+        flags = MAP_SHARED;
+    }
+
+    void *storage = mmap(NULL, size, PROT_READ | PROT_WRITE, flags, dms_ctx->storage_fd, 0);
+    if (storage == MAP_FAILED) {
+        if (dms_ctx->storage_fd >= 0) {
+            close(dms_ctx->storage_fd);
+            dms_ctx->storage_fd = -1;
+        }
+        return DMS_ERROR_MEMORY;
+    }
+    dms_ctx->blocks = storage;
+    dms_ctx->local_storage_size = size;
+    return DMS_SUCCESS;
+}
+
+static void unmap_local_storage(void) {
+    if (dms_ctx->blocks && dms_ctx->local_storage_size > 0) {
+        munmap(dms_ctx->blocks, dms_ctx->local_storage_size);
+    }
+    if (dms_ctx->storage_fd >= 0) {
+        close(dms_ctx->storage_fd);
+    }
+    dms_ctx->blocks = NULL;
+    dms_ctx->local_storage_size = 0;
+    dms_ctx->storage_fd = -1;
+}
+
+// Shift that multiplies by value, or -1 when it is not a power of two
+static int exact_log2(int value) {
+    if (value <= 0 || (value & (value - 1)) != 0) {
+        return -1;
+    }
+    return __builtin_ctz(value);
+}
 
 int dms_init(dms_config_t *config) {
-    if (!config || config->n <= 0 || config->k <= 0 || config->t <= 0) {
+    if (!config || config->n <= 0 || config->n > MAX_PROCESSES || config->k <= 0 || config->t <= 0) {
+        return DMS_ERROR_INVALID_PROCESS;
+    }
+
+    if (config->process_id < 0 || config->process_id >= config->n ||
+        config->batch < 0) {
         return DMS_ERROR_INVALID_PROCESS;
     }
 
-    if (config->process_id < 0 || config->process_id >= config->n) {
+    // The RMA transport already reaches node-local windows through MPI, and
+    // the loopback transport has no MPI at all
+    if (config->shm && config->transport != DMS_TRANSPORT_MESSAGE) {
         return DMS_ERROR_INVALID_PROCESS;
     }
 
+    // Sectors split every block into equal parts with one valid bit each
+    if (config->sector < 0 || (config->sector > 0 && (config->t % config->sector != 0 ||
+                                                     config->t / config->sector > MAX_SECTORS))) {
+        return DMS_ERROR_INVALID_SIZE;
+    }
+
+    // Release consistency keeps writes in the message-served cache; node-local
+    // shm stores and one-sided writes bypass it
+    if (config->coherence == DMS_COHERENCE_RELEASE &&
+        (config->shm || config->transport == DMS_TRANSPORT_RMA)) {
+        return DMS_ERROR_INVALID_PROCESS;
+    }
+
+    // Stores through dms_map() can only be collected as diffs at a release,
+    // and pages are protected one block at a time
+    if (config->map) {
+        if (config->coherence != DMS_COHERENCE_RELEASE) {
+            return DMS_ERROR_INVALID_PROCESS;
+        }
+        if (config->t != sysconf(_SC_PAGESIZE)) {
+            return DMS_ERROR_INVALID_SIZE;
+        }
+    }
+
     dms_ctx = malloc(sizeof(dms_context_t));
     if (!dms_ctx) {
         return DMS_ERROR_MEMORY;
@@ -27,6 +118,15 @@ int dms_init(dms_config_t *config) {
     memset(dms_ctx, 0, sizeof(dms_context_t));
     memcpy(&dms_ctx->config, config, sizeof(dms_config_t));
 
+    // One-sided fetches and stale flags work on whole blocks
+    if (config->sector == 0 || config->transport == DMS_TRANSPORT_RMA) {
+        dms_ctx->config.sector = config->t;
+    }
+
+    dms_ctx->t_shift = exact_log2(config->t);
+    dms_ctx->n_shift = exact_log2(config->n);
+    dms_ctx->sector_shift = exact_log2(dms_ctx->config.sector);
+
     // Calculate how many blocks this process owns
     int blocks_per_process = config->k / config->n;
     int extra_blocks = config->k % config->n;
@@ -35,24 +135,15 @@ int dms_init(dms_config_t *config) {
         local_blocks++;
     }
 
-    size_t local_storage_size = local_blocks * config->t;
-    dms_ctx->blocks = malloc(local_storage_size);
-    if (!dms_ctx->blocks) {
-        free(dms_ctx);
-        return DMS_ERROR_MEMORY;
-    }
-    memset(dms_ctx->blocks, 0, local_storage_size);
-
-    dms_ctx->block_owners = malloc(config->k * sizeof(int));
-    if (!dms_ctx->block_owners) {
-        free(dms_ctx->blocks);
-        free(dms_ctx);
-        return DMS_ERROR_MEMORY;
-    }
-
-    // Calculate block ownership using round-robin distribution
-    for (int i = 0; i < config->k; i++) {
-        dms_ctx->block_owners[i] = i % config->n;
+    // With the RMA transport or the shared-memory fast path the storage is
+    // allocated as an MPI window below
+    if (config->transport != DMS_TRANSPORT_RMA && !config->shm) {
+        if (map_local_storage((size_t)local_blocks * config->t) != DMS_SUCCESS) {
+            free(dms_ctx);
+            return DMS_ERROR_MEMORY;
+        }
+    } else {
+        dms_ctx->storage_fd = -1;
     }
 
     for (int i = 0; i < CACHE_SIZE; i++) {
@@ -62,8 +153,7 @@ int dms_init(dms_config_t *config) {
             for (int j = 0; j < i; j++) {
                 free(dms_ctx->cache[j].data);
             }
-            free(dms_ctx->block_owners);
-            free(dms_ctx->blocks);
+            unmap_local_storage();
             free(dms_ctx);
             return DMS_ERROR_MEMORY;
         }
@@ -72,11 +162,21 @@ int dms_init(dms_config_t *config) {
         pthread_mutex_init(&dms_ctx->cache[i].mutex, NULL);
     }
 
+    for (int i = 0; i < CACHE_SIZE; i++) {
+        dms_ctx->fetch_block[i] = -1;
+    }
+
     pthread_mutex_init(&dms_ctx->cache_mutex, NULL);
     pthread_mutex_init(&dms_ctx->mpi_mutex, NULL);
 
-    MPI_Comm_rank(MPI_COMM_WORLD, &dms_ctx->mpi_rank);
-    MPI_Comm_size(MPI_COMM_WORLD, &dms_ctx->mpi_size);
+    if (config->transport == DMS_TRANSPORT_LOOPBACK) {
+        // Simulated processes are threads; the caller chooses the identity
+        dms_ctx->mpi_rank = config->process_id;
+        dms_ctx->mpi_size = config->n;
+    } else {
+        MPI_Comm_rank(MPI_COMM_WORLD, &dms_ctx->mpi_rank);
+        MPI_Comm_size(MPI_COMM_WORLD, &dms_ctx->mpi_size);
+    }
 
     // Verify MPI configuration matches DMS configuration
     if (dms_ctx->mpi_size != config->n) {
@@ -86,8 +186,7 @@ int dms_init(dms_config_t *config) {
         }
         pthread_mutex_destroy(&dms_ctx->cache_mutex);
         pthread_mutex_destroy(&dms_ctx->mpi_mutex);
-        free(dms_ctx->block_owners);
-        free(dms_ctx->blocks);
+        unmap_local_storage();
         free(dms_ctx);
         return DMS_ERROR_COMMUNICATION;
     }
@@ -96,6 +195,35 @@ int dms_init(dms_config_t *config) {
     config->process_id = dms_ctx->mpi_rank;
     dms_ctx->config.process_id = dms_ctx->mpi_rank;
 
+    int result = transport_init();
+    if (result == DMS_SUCCESS) {
+        result = rc_init();
+    }
+    if (result == DMS_SUCCESS) {
+        result = sync_init();
+    }
+    if (result == DMS_SUCCESS) {
+        result = sharers_init(local_blocks);
+    }
+    if (result != DMS_SUCCESS) {
+        dms_cleanup();
+        return result;
+    }
+
+    if (config->transport == DMS_TRANSPORT_RMA) {
+        result = rma_init(local_blocks);
+        if (result != DMS_SUCCESS) {
+            dms_cleanup();
+            return result;
+        }
+    } else if (config->shm) {
+        result = shm_init(local_blocks);
+        if (result != DMS_SUCCESS) {
+            dms_cleanup();
+            return result;
+        }
+    }
+
     return DMS_SUCCESS;
 }
 
@@ -103,21 +231,22 @@ int get_block_owner(int block_id) {
     if (!dms_ctx || block_id < 0 || block_id >= dms_ctx->config.k) {
         return -1;
     }
-    return dms_ctx->block_owners[block_id];
+    // Round-robin distribution
+    return dms_owner_of(block_id);
 }
 
 int get_block_from_position(int position) {
     if (!dms_ctx || position < 0) {
         return -1;
     }
-    return position / dms_ctx->config.t;
+    return dms_block_of(position);
 }
 
 int get_offset_in_block(int position) {
     if (!dms_ctx || position < 0) {
         return -1;
     }
-    return position % dms_ctx->config.t;
+    return dms_offset_of(position);
 }
 
 cache_entry_t *find_cache_entry(int block_id) {
@@ -145,21 +274,34 @@ cache_entry_t *allocate_cache_entry(int block_id) {
         if (!dms_ctx->cache[i].valid) {
             dms_ctx->cache[i].block_id = block_id;
             dms_ctx->cache[i].valid = 1;
+            dms_ctx->cache[i].sectors = 0;
             dms_ctx->cache[i].dirty = 0;
+            dms_ctx->cache[i].noticed = 0;
             pthread_mutex_unlock(&dms_ctx->cache_mutex);
             return &dms_ctx->cache[i];
         }
     }
 
-    // If no invalid entry, use LRU replacement (simple round-robin for now)
-    static int next_victim = 0;
-    cache_entry_t *victim = &dms_ctx->cache[next_victim];
-    next_victim = (next_victim + 1) % CACHE_SIZE;
+    // If no invalid entry, use LRU replacement (simple round-robin for now),
+    // passing over entries holding unreleased writes when possible
+    cache_entry_t *victim = &dms_ctx->cache[dms_ctx->next_victim];
+    for (int tries = 0; tries < CACHE_SIZE && victim->dirty; tries++) {
+        dms_ctx->next_victim = (dms_ctx->next_victim + 1) % CACHE_SIZE;
+        victim = &dms_ctx->cache[dms_ctx->next_victim];
+    }
+    dms_ctx->next_victim = (dms_ctx->next_victim + 1) % CACHE_SIZE;
+
+    if (victim->dirty && rc_writeback_entry(victim) != DMS_SUCCESS) {
+        pthread_mutex_unlock(&dms_ctx->cache_mutex);
+        return NULL;
+    }
 
     pthread_mutex_lock(&victim->mutex);
     victim->block_id = block_id;
     victim->valid = 1;
+    victim->sectors = 0;
     victim->dirty = 0;
+    victim->noticed = 0;
     pthread_mutex_unlock(&victim->mutex);
 
     pthread_mutex_unlock(&dms_ctx->cache_mutex);
@@ -176,23 +318,19 @@ byte *get_local_block_data(int block_id) {
         return NULL;
     }
 
-    // Calculate local offset for this block
-    int local_block_index = 0;
-    for (int i = 0; i < block_id; i++) {
-        if (get_block_owner(i) == dms_ctx->config.process_id) {
-            local_block_index++;
-        }
-    }
-
-    return dms_ctx->blocks + (local_block_index * dms_ctx->config.t);
+    return dms_owned_data_of(block_id);
 }
 
 void dms_flush_local_cache(void) {
     if (!dms_ctx) return;
 
+    // Unreleased writes would be lost with the entries
+    dms_release();
+    map_drop_remote();
+
     pthread_mutex_lock(&dms_ctx->cache_mutex);
 
-    printf("DEBUG: Flushing local cache (128 entries)...\n");
+    DMS_DEBUG("DEBUG: Flushing local cache (128 entries)...\n");
 
     for (int i = 0; i < CACHE_SIZE; i++) {
         pthread_mutex_lock(&dms_ctx->cache[i].mutex);
@@ -203,7 +341,15 @@ void dms_flush_local_cache(void) {
     }
 
     pthread_mutex_unlock(&dms_ctx->cache_mutex);
-    printf("DEBUG: Cache flush complete\n");
+    DMS_DEBUG("DEBUG: Cache flush complete\n");
+}
+
+dms_context_t *dms_get_context(void) {
+    return dms_ctx;
+}
+
+void dms_set_context(dms_context_t *ctx) {
+    dms_ctx = ctx;
 }
 
 int dms_cleanup(void) {
@@ -211,6 +357,12 @@ int dms_cleanup(void) {
         return DMS_SUCCESS;
     }
 
+    map_cleanup();
+    transport_cleanup();
+    rc_cleanup();
+    sync_cleanup();
+    sharers_cleanup();
+
     for (int i = 0; i < CACHE_SIZE; i++) {
         if (dms_ctx->cache[i].data) {
             free(dms_ctx->cache[i].data);
@@ -221,12 +373,14 @@ int dms_cleanup(void) {
     pthread_mutex_destroy(&dms_ctx->cache_mutex);
     pthread_mutex_destroy(&dms_ctx->mpi_mutex);
 
-    if (dms_ctx->blocks) {
-        free(dms_ctx->blocks);
-    }
+    free_readonly_regions();
 
-    if (dms_ctx->block_owners) {
-        free(dms_ctx->block_owners);
+    if (dms_ctx->config.transport == DMS_TRANSPORT_RMA) {
+        rma_cleanup();
+    } else if (dms_ctx->config.shm) {
+        shm_cleanup();
+    } else {
+        unmap_local_storage();
     }
 
     free(dms_ctx);
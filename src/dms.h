@@ -4,17 +4,45 @@
 #include <fcntl.h>
 #include <mpi.h>
 #include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
 #include <stdint.h>
 #include <sys/types.h>
 
-#define MAX_PROCESSES 16
+#define MAX_PROCESSES 1024  // process ids fit the int16 relay lists of MSG_INVALIDATE
 #define MAX_BLOCK_SIZE 4096
 #define MAX_BLOCKS 1000000
 #define CACHE_SIZE 128
 #define MESSAGE_SIZE 256
+#define MAX_READONLY_REGIONS 16
+#define MAX_SECTORS 64  // per block, one valid bit each in cache_entry_t.sectors
+#define NOTICES_PER_MESSAGE (MAX_BLOCK_SIZE / (int)sizeof(int32_t))  // int32 block ids
+#define LOCK_TABLE_SIZE 64  // hash buckets of the locks a process is home for
+#define SHARER_BITS 64      // per owned block, each bit covers ceil(n / 64) processes
+#define DMS_INVALIDATE_FANOUT 8  // invalidations to more processes go through relays
+#define INVALIDATION_LOG 64  // unordered invalidations remembered by a reader
+
+// Message aggregation: small messages to the same destination are packed
+// into one MSG_BATCH of up to 'batch' bytes (config, 0 disables)
+#define DMS_BATCH_DEFAULT 1024
+#define DMS_BATCH_MAX_PAYLOAD 64   // larger messages are always sent alone
+#define DMS_BATCH_WINDOW_US 200    // oldest packed message is sent after this
+
+// Read responses: all-zero ranges are sent as a flag, and with 'compress'
+// (link speed in MB/s) larger ones may be run-length encoded
+#define DMS_COMPRESS_MIN_PAYLOAD 256
 
 typedef uint8_t byte;
 
+// Protocol tracing, on by default; disabled with -q or 'debug 0'
+extern int dms_debug;
+#define DMS_DEBUG(...)                \
+    do {                              \
+        if (dms_debug) {              \
+            printf(__VA_ARGS__);      \
+        }                             \
+    } while (0)
+
 typedef enum {
     DMS_SUCCESS = 0,
     DMS_ERROR_INVALID_POSITION = -1,
@@ -22,30 +50,81 @@ typedef enum {
     DMS_ERROR_BLOCK_NOT_FOUND = -3,
     DMS_ERROR_COMMUNICATION = -4,
     DMS_ERROR_MEMORY = -5,
-    DMS_ERROR_INVALID_PROCESS = -6
+    DMS_ERROR_INVALID_PROCESS = -6,
+    DMS_ERROR_READONLY = -7,
+    DMS_ERROR_IO = -8
 } dms_error_t;
 
 typedef enum {
-    MSG_READ_REQUEST,
-    MSG_READ_RESPONSE,
+    MSG_READ_REQUEST,     // position: first byte, data: int32 length (whole block if absent)
+    MSG_READ_RESPONSE,    // the requested range from 'position', maybe encoded (dms_codec.c)
     MSG_WRITE_REQUEST,
     MSG_WRITE_RESPONSE,
-    MSG_INVALIDATE,
-    MSG_INVALIDATE_ACK
+    MSG_INVALIDATE,       // position/int32 length like MSG_READ_REQUEST, then int16 ids to relay to
+    MSG_INVALIDATE_ACK,
+    MSG_FETCH_ADD,        // atomics carry a dms_atomic_args_t, executed by the owner
+    MSG_CAS,
+    MSG_SWAP,
+    MSG_ATOMIC_RESPONSE,  // carries a dms_atomic_result_t
+    MSG_DIFF,             // release consistency: (offset, length, bytes) runs
+    MSG_DIFF_ACK,
+    MSG_WRITE_NOTICE,     // int32 ids of blocks changed before a release
+    MSG_WRITE_NOTICE_ACK,
+    MSG_LOCK_REQUEST,     // block_id is the lock id, sent to its home process
+    MSG_LOCK_GRANT,       // carries write notices (int32 ids) for the new holder
+    MSG_UNLOCK,           // carries the holder's write notices
+    MSG_BARRIER_ENTER,    // block_id is the barrier epoch, sent to process 0
+    MSG_BARRIER_RELEASE,  // carries every process' write notices
+    MSG_APPLY,            // position: global start, data: dms_apply_args_t (dms_apply.c)
+    MSG_APPLY_RESPONSE,   // the owner's partial result
+    MSG_COPY,             // to a source owner; position: source, data: dms_copy_args_t (dms_copy.c)
+    MSG_COPY_DATA,        // source owner to destination owner, bytes at 'position' of the block
+    MSG_COPY_DATA_ACK,    // position: status
+    MSG_FILL,             // to a destination owner; position: start, data: dms_fill_args_t
+    MSG_COPY_DONE,        // answers MSG_COPY and MSG_FILL, position: status
+    MSG_INVALIDATE_RANGE, // position: global start, data: int32 length; answered with MSG_INVALIDATE_ACK
+    MSG_BATCH  // data holds packed messages, 'size' bytes in total
 } message_type_t;
 
+// First byte of a read response payload shorter than the requested range
+typedef enum {
+    DMS_PAYLOAD_ZERO = 1,  // nothing follows
+    DMS_PAYLOAD_RLE = 2    // PackBits runs follow
+} dms_payload_encoding_t;
+
+typedef enum {
+    DMS_TRANSPORT_MESSAGE = 0,  // two-sided MPI_Send/MPI_Recv served by the owner
+    DMS_TRANSPORT_RMA = 1,      // one-sided MPI_Get/MPI_Accumulate on MPI windows
+    DMS_TRANSPORT_LOOPBACK = 2  // in-process, one thread per process (no MPI)
+} dms_transport_t;
+
+typedef enum {
+    DMS_COHERENCE_STRICT = 0,  // every escreve() invalidates the other caches
+    DMS_COHERENCE_RELEASE = 1  // lazy release consistency, dms_acquire()/dms_release()
+} dms_coherence_t;
+
 typedef struct {
     int n;           // number of processes
     int k;           // number of blocks
     int t;           // block size in bytes
     int process_id;  // current process ID
+    dms_transport_t transport;
+    int shm;         // direct load/store access to blocks of node-local owners
+    int batch;       // per-destination aggregation threshold in bytes, 0 = off
+    dms_coherence_t coherence;
+    int sector;      // transfer and invalidation unit in bytes, 0 = whole block
+    int compress;    // link speed in MB/s for adaptive RLE of read responses, 0 = off
+    int map;         // dms_map() pointer access, needs release coherence and t = page size
 } dms_config_t;
 
 typedef struct {
     int block_id;
     byte *data;
     int valid;
-    int dirty;
+    uint64_t sectors;  // bit i: bytes [i * sector, (i + 1) * sector) of data are valid
+    int dirty;       // release consistency: data differs from twin
+    byte *twin;      // release consistency: contents before our first write
+    int noticed;     // release consistency: dropped at the next dms_acquire()
     pthread_mutex_t mutex;
 } cache_entry_t;
 
@@ -59,25 +138,222 @@ typedef struct {
     byte data[MAX_BLOCK_SIZE];
 } dms_message_t;
 
+// One element of le_v() / escreve_v()
+typedef struct {
+    int posicao;
+    byte *buffer;
+    int tamanho;
+} dms_iovec_t;
+
+typedef struct {
+    int64_t operand;   // addend or new value
+    int64_t expected;  // compared value (MSG_CAS only)
+    int32_t width;     // 4 or 8 bytes
+} dms_atomic_args_t;
+
+typedef struct {
+    int64_t previous;  // value before the operation
+    int32_t changed;   // caches were invalidated
+} dms_atomic_result_t;
+
+// Operations of dms_apply(); ids from DMS_APPLY_FIRST_KERNEL on are free for
+// dms_register_kernel()
+typedef enum {
+    DMS_APPLY_SUM,    // int64 elements, wrapping
+    DMS_APPLY_MIN,
+    DMS_APPLY_MAX,
+    DMS_APPLY_COUNT,  // int64 elements equal to arg
+    DMS_APPLY_FIND,   // position of the first byte equal to arg, -1 if none
+    DMS_APPLY_FIRST_KERNEL = 8
+} dms_apply_op_t;
+
+#define DMS_MAX_KERNELS 32
+
+// A reduction run by the owners. scan() folds a contiguous piece of one
+// block, starting at global position 'posicao', into *acc (which starts at
+// 'identity'); combine() merges the partial results of two owners.
+typedef struct {
+    int width;  // element size; the position, the length and t must be multiples of it
+    int64_t identity;
+    void (*scan)(const byte *data, int posicao, int tamanho, int64_t arg, int64_t *acc);
+    int64_t (*combine)(int64_t a, int64_t b);
+} dms_kernel_t;
+
+// Bytes of a message that actually go on the wire
+static inline size_t dms_message_size(const dms_message_t *msg) {
+    return offsetof(dms_message_t, data) + msg->size;
+}
+
+// Message transport interface. receive_message() posts a receive and then
+// polls it with progress(); waiters that find nothing call wait(), which may
+// return early as soon as a message can be received.
+typedef struct {
+    const char *name;
+    int (*send)(int target_pid, const void *buf, size_t nbytes);
+    int (*post_receive)(void);
+    int (*progress)(void *buf, size_t capacity, size_t *nbytes);
+    int (*wait)(int timeout_us);
+    void (*finalize)(void);
+} dms_transport_ops_t;
+
+typedef struct deferred_message {
+    struct deferred_message *next;
+    dms_message_t msg;
+} deferred_message_t;
+
+typedef struct {
+    const dms_transport_ops_t *ops;
+    // MPI backend: one receive is kept pre-posted into recv_buffer
+    MPI_Request recv_request;
+    int recv_posted;
+    dms_message_t *recv_buffer;
+    // Aggregation: one MSG_BATCH being filled per destination, and the
+    // received batch being unpacked
+    dms_message_t **outbox;  // allocated on the first message to the destination
+    int *outbox_count;
+    uint64_t *outbox_since;  // when the oldest packed message was queued, in us
+    int *pending;            // destinations with packed messages, so flushes skip the others
+    int num_pending;
+    dms_message_t *inbox;
+    int inbox_offset;
+} dms_transport_state_t;
+
+// Lock home and barrier coordinator state, private to dms_sync.c
+typedef struct dms_sync_state dms_sync_state_t;
+
+// Page table of the dms_map() range, private to dms_map.c
+typedef struct dms_map_state dms_map_state_t;
+
+typedef struct {
+    int first_block;
+    int last_block;
+    int replicated;
+    byte *data;  // local replica of blocks [first_block, last_block]
+} readonly_region_t;
+
 typedef struct {
     dms_config_t config;
+    int t_shift;       // log2(t) when t is a power of two, else -1
+    int n_shift;       // log2(n) likewise
+    int sector_shift;  // log2(config.sector) likewise
     byte *blocks;
-    int *block_owners;
+    size_t local_storage_size;  // bytes mapped for blocks, 0 when MPI allocated them
+    int storage_fd;             // config.map: memory file behind blocks, else -1
     cache_entry_t cache[CACHE_SIZE];
+    int next_victim;
     pthread_mutex_t cache_mutex;
     pthread_mutex_t mpi_mutex;
+    MPI_Win rma_data_win;   // exposes blocks
+    MPI_Win rma_dir_win;    // exposes rma_sharers
+    MPI_Win rma_inval_win;  // exposes rma_inval
+    uint64_t *rma_sharers;  // per local block sharer vector of processes caching it
+    byte *rma_inval;        // per block slot (block_id % slots) flag set by remote writers
+    int rma_inval_slots;
+    MPI_Comm shm_comm;      // processes sharing this node
+    MPI_Win shm_win;        // node-shared block storage and sequence counters
+    byte **shm_peer_blocks;      // per process, NULL when off-node
+    uint32_t **shm_peer_seq;     // per process, one seqlock counter per block
+    readonly_region_t readonly_regions[MAX_READONLY_REGIONS];
+    int num_readonly_regions;
+    dms_transport_state_t *transport;
+    deferred_message_t *deferred;  // responses received by a nested wait
+    uint64_t *sharers;      // per owned block, sharer vector of processes that fetched it
+    int sharer_group;       // processes per sharer vector bit
+    uint64_t invalidations_sent;  // MSG_INVALIDATE messages, relayed ones included
+    // Invalidations not sent by the block's owner (relayed, or from a
+    // node-local writer) may overtake its read responses (dms_communication.c)
+    int32_t unordered_invalidations[INVALIDATION_LOG];  // ring of block ids
+    uint32_t num_unordered;
+    int32_t fetch_block[CACHE_SIZE];   // outstanding read requests, at block_id % CACHE_SIZE
+    uint32_t fetch_stamp[CACHE_SIZE];  // num_unordered when they were sent
+    int *written_blocks;    // release consistency: blocks to notify at release
+    int num_written_blocks;
+    int written_capacity;
+    byte *written_flags;    // per block, already in written_blocks
+    dms_sync_state_t *sync;
+    dms_map_state_t *map;
+    double rle_ratio;        // moving averages of RLE on our read responses
+    double rle_bytes_per_us;
+    int rle_samples;
+    int rle_skipped;         // payloads sent without trying RLE since the last try
+    uint64_t payload_bytes;       // read response bytes before encoding
+    uint64_t payload_bytes_sent;  // and after
     int mpi_rank;
     int mpi_size;
 } dms_context_t;
 
-extern dms_context_t *dms_ctx;
+// Each thread acting for a process sees that process' context; additional
+// application threads attach with dms_set_context()
+extern __thread dms_context_t *dms_ctx;
+
+// Address arithmetic of the le()/escreve() loops, for positions and block
+// ids the caller has already checked. Shifts and masks replace the divisions
+// when dms_init() found t, n and the sector size to be powers of two.
+static inline int dms_block_of(int position) {
+    return dms_ctx->t_shift >= 0 ? position >> dms_ctx->t_shift : position / dms_ctx->config.t;
+}
+
+static inline int dms_offset_of(int position) {
+    return dms_ctx->t_shift >= 0 ? position & (dms_ctx->config.t - 1) : position % dms_ctx->config.t;
+}
+
+static inline int dms_owner_of(int block_id) {
+    return dms_ctx->n_shift >= 0 ? block_id & (dms_ctx->config.n - 1) : block_id % dms_ctx->config.n;
+}
+
+// Round-robin: our blocks are pid, pid + n, pid + 2n, ... in local storage
+static inline byte *dms_owned_data_of(int block_id) {
+    size_t index = dms_ctx->n_shift >= 0 ? (size_t)(block_id >> dms_ctx->n_shift)
+                                         : (size_t)(block_id / dms_ctx->config.n);
+    return dms_ctx->blocks + index * dms_ctx->config.t;
+}
+
+// Sharer vectors (dms_sharers.c, dms_rma.c): bit i stands for processes
+// [i * sharer_group, (i + 1) * sharer_group), exact up to SHARER_BITS processes
+static inline uint64_t dms_sharer_bit(int pid) {
+    return (uint64_t)1 << (pid / dms_ctx->sharer_group);
+}
+
+// Sectors of a block touched by [offset, offset + size)
+static inline uint64_t get_sector_mask(int offset, int size) {
+    int first, last;
+    if (dms_ctx->sector_shift >= 0) {
+        first = offset >> dms_ctx->sector_shift;
+        last = (offset + size - 1) >> dms_ctx->sector_shift;
+    } else {
+        first = offset / dms_ctx->config.sector;
+        last = (offset + size - 1) / dms_ctx->config.sector;
+    }
+    int count = last - first + 1;
+    uint64_t bits = count >= MAX_SECTORS ? ~(uint64_t)0 : ((uint64_t)1 << count) - 1;
+    return bits << first;
+}
 
 // API Functions
 int dms_init(dms_config_t *config);
 int le(int posicao, byte *buffer, int tamanho);
 int escreve(int posicao, byte *buffer, int tamanho);
+int le_v(const dms_iovec_t *elementos, int quantidade);
+int escreve_v(const dms_iovec_t *elementos, int quantidade);
 int dms_cleanup(void);
 void dms_flush_local_cache(void);
+dms_context_t *dms_get_context(void);
+void dms_set_context(dms_context_t *ctx);
+int dms_fetch_add(int posicao, int tamanho, int64_t valor, int64_t *anterior);
+int dms_cas(int posicao, int tamanho, int64_t esperado, int64_t novo, int64_t *anterior);
+int dms_swap(int posicao, int tamanho, int64_t novo, int64_t *anterior);
+int dms_acquire(void);
+int dms_release(void);
+int dms_lock(int id);
+int dms_unlock(int id);
+int dms_barrier(void);
+int dms_map(byte **base);
+int dms_apply(int posicao, int tamanho, int op, int64_t arg, int64_t *resultado);
+int dms_register_kernel(int op, const dms_kernel_t *kernel);
+int dms_copy(int destino, int origem, int tamanho);
+int dms_fill(int posicao, byte valor, int tamanho);
+int dms_load(const char *caminho);
+int dms_checkpoint(const char *caminho);
 
 // Internal Functions
 int get_block_owner(int block_id);
@@ -86,13 +362,111 @@ int get_offset_in_block(int position);
 cache_entry_t *find_cache_entry(int block_id);
 cache_entry_t *allocate_cache_entry(int block_id);
 int request_block_from_owner(int block_id, int owner_pid);
+int request_sectors_from_owner(int block_id, int owner_pid, uint64_t sectors);
+int send_read_request(int block_id, int owner_pid, uint64_t sectors);
+int receive_read_response(int block_id, uint64_t sectors);
 int send_message(int target_pid, dms_message_t *msg);
 int receive_message(dms_message_t *msg);
 int invalidate_cache_entry(int block_id);
+void drop_written_sectors(int block_id, int offset, int size);
 int handle_incoming_messages(void);
 byte *get_local_block_data(int block_id);
 int handle_message(dms_message_t *msg);
-int invalidate_cache_and_wait_acks(int block_id, int requester_pid);
+int wait_for_message(message_type_t type, int block_id, dms_message_t *response);
+int wait_for_message_timeout(message_type_t type, int block_id, dms_message_t *response,
+                             int timeout_ms);
+
+// Transport Functions
+int transport_init(void);
+void transport_cleanup(void);
+int transport_send(int target_pid, const dms_message_t *msg);
+int transport_receive(dms_message_t *msg);
+int transport_flush(void);
+extern const dms_transport_ops_t mpi_transport_ops;
+extern const dms_transport_ops_t loopback_transport_ops;
+int dms_loopback_create(int n);
+void dms_loopback_destroy(void);
+
+// Sharer Directory Functions
+int sharers_init(int local_blocks);
+void sharers_cleanup(void);
+void sharers_note_reader(int block_id, int pid);
+int invalidate_cache_and_wait_acks(int block_id, int offset, int size, int requester_pid);
+int relay_invalidation(const dms_message_t *msg);
+
+// Atomic Operation Functions
+int atomic_apply(message_type_t op, byte *target, const dms_atomic_args_t *args,
+                 dms_atomic_result_t *result);
+int handle_atomic_request(dms_message_t *msg);
+
+// Near-data Reduction Functions
+int handle_apply_request(dms_message_t *msg);
+
+// Bulk Copy Functions
+int handle_copy_request(dms_message_t *msg);
+int handle_copy_data(dms_message_t *msg);
+int handle_fill_request(dms_message_t *msg);
+int handle_invalidate_range(dms_message_t *msg);
+
+// Release Consistency Functions
+int rc_init(void);
+void rc_cleanup(void);
+int rc_note_written(int block_id);
+int rc_write_cached(int block_id, int owner, int offset, const byte *src, int size);
+int rc_writeback_entry(cache_entry_t *entry);
+int rc_send_diff(int block_id, const byte *data, const byte *twin, int *messages);
+int rc_wait_diff_acks(int block_id, int messages);
+int handle_diff(dms_message_t *msg);
+int handle_write_notice(dms_message_t *msg);
+int rc_flush_diffs(void);
+void rc_pack_notices(dms_message_t *msg);
+int rc_apply_notices(const dms_message_t *msg);
+
+// Payload Encoding Functions
+int payload_is_zero(const byte *data, int size);
+int payload_encode(const byte *src, int size, byte *dest);
+int payload_decode(const byte *src, int encoded_size, byte *dest, int size);
+
+// Lock and Barrier Functions
+int sync_init(void);
+void sync_cleanup(void);
+int handle_lock_request(dms_message_t *msg);
+int handle_unlock(dms_message_t *msg);
+int handle_barrier_enter(dms_message_t *msg);
+
+// Mapped Memory Functions
+void map_cleanup(void);
+void map_notice(int block_id);
+void map_notice_all(void);
+int map_drop_noticed(void);
+int map_drop_remote(void);
+int map_flush_diffs(void);
+
+// Read-only Replication Functions
+int dms_mark_readonly(int posicao, int tamanho);
+int dms_unmark_readonly(int posicao, int tamanho);
+int dms_replicate(void);
+byte *get_replica_block_data(int block_id);
+int is_readonly_range(int posicao, int tamanho);
+void free_readonly_regions(void);
+
+// RMA Transport Functions
+int rma_init(int local_blocks);
+void rma_cleanup(void);
+int rma_fetch_block(int block_id, int owner_pid);
+int rma_block_is_stale(int block_id);
+int rma_write_block(int block_id, int owner_pid, int offset, const byte *data, int size);
+int rma_atomic_block(message_type_t op, int block_id, int offset,
+                     const dms_atomic_args_t *args, dms_atomic_result_t *result);
+
+// Shared-Memory Fast Path Functions
+int shm_init(int local_blocks);
+void shm_cleanup(void);
+int shm_is_node_local(int pid);
+int shm_read(int block_id, int offset, byte *dest, int size);
+int shm_write(int block_id, int offset, const byte *src, int size);
+int shm_atomic(message_type_t op, int block_id, int offset,
+               const dms_atomic_args_t *args, dms_atomic_result_t *result);
 
 // Configuration Functions
 int load_config_from_file(const char *filename, dms_config_t *config);
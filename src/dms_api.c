@@ -11,8 +11,8 @@ int le(int posicao, byte *buffer, int tamanho) {
         return DMS_ERROR_INVALID_POSITION;
     }
 
-    int total_memory_size = dms_ctx->config.k * dms_ctx->config.t;
-    if (posicao + tamanho > total_memory_size) {
+    int64_t total_memory_size = (int64_t)dms_ctx->config.k * dms_ctx->config.t;
+    if ((int64_t)posicao + tamanho > total_memory_size) {
         return DMS_ERROR_INVALID_SIZE;
     }
 
@@ -20,9 +20,9 @@ int le(int posicao, byte *buffer, int tamanho) {
 
     while (bytes_read < tamanho) {
         int current_position = posicao + bytes_read;
-        int block_id = get_block_from_position(current_position);
-        int offset_in_block = get_offset_in_block(current_position);
-        int owner = get_block_owner(block_id);
+        int block_id = dms_block_of(current_position);
+        int offset_in_block = dms_offset_of(current_position);
+        int owner = dms_owner_of(block_id);
 
         if (block_id < 0 || block_id >= dms_ctx->config.k) {
             return DMS_ERROR_INVALID_POSITION;
@@ -34,51 +34,70 @@ int le(int posicao, byte *buffer, int tamanho) {
         int bytes_to_read = (remaining_in_block < remaining_to_read) ? remaining_in_block : remaining_to_read;
 
         byte *data_source = NULL;
+        cache_entry_t *locked_entry = NULL;
 
-        if (owner == dms_ctx->config.process_id) {
-            data_source = get_local_block_data(block_id);
-            if (!data_source) {
-                return DMS_ERROR_BLOCK_NOT_FOUND;
+        if (dms_ctx->num_readonly_regions > 0) {
+            data_source = get_replica_block_data(block_id);
+        }
+
+        if (data_source) {
+            // Replicated read-only block - served locally without cache lookup
+        } else if (dms_ctx->shm_peer_blocks && shm_is_node_local(owner)) {
+            // Node-local owner (possibly ourselves) - direct load from its segment
+            int result = shm_read(block_id, offset_in_block, buffer + bytes_read, bytes_to_read);
+            if (result != DMS_SUCCESS) {
+                return result;
             }
+            bytes_read += bytes_to_read;
+            continue;
+        } else if (owner == dms_ctx->config.process_id) {
+            data_source = dms_owned_data_of(block_id);
         } else {
             // Remote block - check cache first
-            printf("DEBUG: Process %d reading from remote block %d (owner=%d)\n",
-                   dms_ctx->mpi_rank, block_id, owner);
+            DMS_DEBUG("DEBUG: Process %d reading from remote block %d (owner=%d)\n",
+                      dms_ctx->mpi_rank, block_id, owner);
 
             cache_entry_t *cache_entry = find_cache_entry(block_id);
+            uint64_t needed = get_sector_mask(offset_in_block, bytes_to_read);
+
+            if (cache_entry && dms_ctx->config.transport == DMS_TRANSPORT_RMA &&
+                rma_block_is_stale(block_id)) {
+                invalidate_cache_entry(block_id);
+                cache_entry = NULL;
+            }
 
-            if (cache_entry && cache_entry->valid) {
-                printf("DEBUG: Cache hit for block %d\n", block_id);
+            if (cache_entry && (cache_entry->sectors & needed) == needed) {
+                DMS_DEBUG("DEBUG: Cache hit for block %d\n", block_id);
                 pthread_mutex_lock(&cache_entry->mutex);
+                locked_entry = cache_entry;
                 data_source = cache_entry->data;
             } else {
-                // Cache miss - request block from owner
-                printf("DEBUG: Cache miss for block %d, requesting from owner\n", block_id);
-                int result = request_block_from_owner(block_id, owner);
+                // Cache miss - request the missing sectors from the owner
+                DMS_DEBUG("DEBUG: Cache miss for block %d, requesting from owner\n", block_id);
+                uint64_t missing = needed & ~(cache_entry ? cache_entry->sectors : 0);
+                int result = request_sectors_from_owner(block_id, owner, missing);
                 if (result != DMS_SUCCESS) {
-                    printf("DEBUG: Failed to get remote block %d\n", block_id);
+                    DMS_DEBUG("DEBUG: Failed to get remote block %d\n", block_id);
                     return result;
                 }
 
                 // Cache entry should now be available after request
                 cache_entry = find_cache_entry(block_id);
                 if (!cache_entry) {
-                    printf("DEBUG: Cache entry not found after request\n");
+                    DMS_DEBUG("DEBUG: Cache entry not found after request\n");
                     return DMS_ERROR_MEMORY;
                 }
 
                 pthread_mutex_lock(&cache_entry->mutex);
+                locked_entry = cache_entry;
                 data_source = cache_entry->data;
             }
         }
 
         memcpy(buffer + bytes_read, data_source + offset_in_block, bytes_to_read);
 
-        if (owner != dms_ctx->config.process_id) {
-            cache_entry_t *cache_entry = find_cache_entry(block_id);
-            if (cache_entry) {
-                pthread_mutex_unlock(&cache_entry->mutex);
-            }
+        if (locked_entry) {
+            pthread_mutex_unlock(&locked_entry->mutex);
         }
 
         bytes_read += bytes_to_read;
@@ -92,18 +111,22 @@ int escreve(int posicao, byte *buffer, int tamanho) {
         return DMS_ERROR_INVALID_POSITION;
     }
 
-    int total_memory_size = dms_ctx->config.k * dms_ctx->config.t;
-    if (posicao + tamanho > total_memory_size) {
+    int64_t total_memory_size = (int64_t)dms_ctx->config.k * dms_ctx->config.t;
+    if ((int64_t)posicao + tamanho > total_memory_size) {
         return DMS_ERROR_INVALID_SIZE;
     }
 
+    if (is_readonly_range(posicao, tamanho)) {
+        return DMS_ERROR_READONLY;
+    }
+
     int bytes_written = 0;
 
     while (bytes_written < tamanho) {
         int current_position = posicao + bytes_written;
-        int block_id = get_block_from_position(current_position);
-        int offset_in_block = get_offset_in_block(current_position);
-        int owner = get_block_owner(block_id);
+        int block_id = dms_block_of(current_position);
+        int offset_in_block = dms_offset_of(current_position);
+        int owner = dms_owner_of(block_id);
 
         if (block_id < 0 || block_id >= dms_ctx->config.k) {
             return DMS_ERROR_INVALID_POSITION;
@@ -114,21 +137,52 @@ int escreve(int posicao, byte *buffer, int tamanho) {
         int remaining_to_write = tamanho - bytes_written;
         int bytes_to_write = (remaining_in_block < remaining_to_write) ? remaining_in_block : remaining_to_write;
 
-        if (owner == dms_ctx->config.process_id) {
-            printf("DEBUG: Process %d writing to local block\n", dms_ctx->mpi_rank);
-            byte *local_data = get_local_block_data(block_id);
-            if (!local_data) {
-                return DMS_ERROR_BLOCK_NOT_FOUND;
+        if (dms_ctx->config.transport == DMS_TRANSPORT_RMA) {
+            // Local and remote blocks alike go through the window so that
+            // concurrent one-sided readers observe well-defined updates
+            int result = rma_write_block(block_id, owner, offset_in_block,
+                                         buffer + bytes_written, bytes_to_write);
+            if (result != DMS_SUCCESS) {
+                return result;
+            }
+        } else if (dms_ctx->shm_peer_blocks && shm_is_node_local(owner)) {
+            // Node-local owner - direct store, then invalidate off-node caches
+            int result = shm_write(block_id, offset_in_block, buffer + bytes_written, bytes_to_write);
+            if (result != DMS_SUCCESS) {
+                return result;
             }
 
+            invalidate_cache_and_wait_acks(block_id, offset_in_block, bytes_to_write,
+                                           dms_ctx->config.process_id);
+
+        } else if (owner == dms_ctx->config.process_id) {
+            DMS_DEBUG("DEBUG: Process %d writing to local block\n", dms_ctx->mpi_rank);
+            byte *local_data = dms_owned_data_of(block_id);
             memcpy(local_data + offset_in_block, buffer + bytes_written, bytes_to_write);
 
-            // Invalidate cache entries in other processes for consistency
-            invalidate_cache_and_wait_acks(block_id, dms_ctx->config.process_id);
+            if (dms_ctx->config.coherence == DMS_COHERENCE_RELEASE) {
+                // Other processes learn about it from the notice at our next release
+                int result = rc_note_written(block_id);
+                if (result != DMS_SUCCESS) {
+                    return result;
+                }
+            } else {
+                // Invalidate cache entries in other processes for consistency
+                invalidate_cache_and_wait_acks(block_id, offset_in_block, bytes_to_write,
+                                               dms_ctx->config.process_id);
+            }
+
+        } else if (dms_ctx->config.coherence == DMS_COHERENCE_RELEASE) {
+            // Remote block - write into our cached copy, diffed at release
+            int result = rc_write_cached(block_id, owner, offset_in_block,
+                                         buffer + bytes_written, bytes_to_write);
+            if (result != DMS_SUCCESS) {
+                return result;
+            }
 
         } else {
-            printf("DEBUG: Process %d writing to remote block %d (owner=%d)\n",
-                   dms_ctx->mpi_rank, block_id, owner);
+            DMS_DEBUG("DEBUG: Process %d writing to remote block %d (owner=%d)\n",
+                      dms_ctx->mpi_rank, block_id, owner);
 
             dms_message_t write_request;
             memset(&write_request, 0, sizeof(write_request));
@@ -140,48 +194,22 @@ int escreve(int posicao, byte *buffer, int tamanho) {
 
             int result = send_message(owner, &write_request);
             if (result != DMS_SUCCESS) {
-                printf("DEBUG: Failed to send write request\n");
+                DMS_DEBUG("DEBUG: Failed to send write request\n");
                 return result;
             }
 
-            printf("DEBUG: Process %d sent write request, waiting for response...\n", dms_ctx->mpi_rank);
+            DMS_DEBUG("DEBUG: Process %d sent write request, waiting for response...\n", dms_ctx->mpi_rank);
 
-            // Wait for acknowledgment with timeout
+            // Wait for acknowledgment, serving other requests meanwhile
             dms_message_t response;
-            int attempts = 0;
-            const int max_attempts = 1000;  // 1 second timeout
-            int found_response = 0;
-
-            while (attempts < max_attempts && !found_response) {
-                result = receive_message(&response);
-                if (result == DMS_SUCCESS) {
-                    if (response.type == MSG_WRITE_RESPONSE && response.block_id == block_id) {
-                        printf("DEBUG: Process %d got write response\n", dms_ctx->mpi_rank);
-                        found_response = 1;
-                    } else {
-                        // Handle other messages that aren't our response
-                        printf("DEBUG: Process %d handling other message type %d\n", dms_ctx->mpi_rank, response.type);
-                        handle_message(&response);
-                    }
-                } else {
-                    attempts++;
-                    usleep(1000);  // 1ms delay
-                }
-            }
-
-            if (!found_response) {
-                printf("DEBUG: Process %d timed out waiting for write response\n", dms_ctx->mpi_rank);
-                return DMS_ERROR_COMMUNICATION;
+            result = wait_for_message(MSG_WRITE_RESPONSE, block_id, &response);
+            if (result != DMS_SUCCESS) {
+                DMS_DEBUG("DEBUG: Process %d timed out waiting for write response\n", dms_ctx->mpi_rank);
+                return result;
             }
+            DMS_DEBUG("DEBUG: Process %d got write response\n", dms_ctx->mpi_rank);
 
-            // Invalidate our own cache entry for this block
-            cache_entry_t *cache_entry = find_cache_entry(block_id);
-            if (cache_entry) {
-                pthread_mutex_lock(&cache_entry->mutex);
-                cache_entry->valid = 0;
-                cache_entry->dirty = 0;
-                pthread_mutex_unlock(&cache_entry->mutex);
-            }
+            drop_written_sectors(block_id, offset_in_block, bytes_to_write);
         }
 
         bytes_written += bytes_to_write;
@@ -190,6 +218,21 @@ int escreve(int posicao, byte *buffer, int tamanho) {
     return DMS_SUCCESS;
 }
 
+// Invalidates the written sectors of our own cache entry once the owner
+// acknowledged a remote write
+void drop_written_sectors(int block_id, int offset, int size) {
+    cache_entry_t *cache_entry = find_cache_entry(block_id);
+    if (cache_entry) {
+        pthread_mutex_lock(&cache_entry->mutex);
+        cache_entry->sectors &= ~get_sector_mask(offset, size);
+        if (cache_entry->sectors == 0) {
+            cache_entry->valid = 0;
+        }
+        cache_entry->dirty = 0;
+        pthread_mutex_unlock(&cache_entry->mutex);
+    }
+}
+
 int invalidate_cache_entry(int block_id) {
     if (!dms_ctx || block_id < 0 || block_id >= dms_ctx->config.k) {
         return DMS_ERROR_INVALID_POSITION;
@@ -198,8 +241,12 @@ int invalidate_cache_entry(int block_id) {
     cache_entry_t *entry = find_cache_entry(block_id);
     if (entry) {
         pthread_mutex_lock(&entry->mutex);
-        entry->valid = 0;
-        entry->dirty = 0;
+        if (entry->dirty) {
+            // Unreleased writes: dropped only after they reach the owner
+            entry->noticed = 1;
+        } else {
+            entry->valid = 0;
+        }
         pthread_mutex_unlock(&entry->mutex);
     }
 
@@ -0,0 +1,291 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dms.h"
+
+// Near-data reductions. dms_apply() sends one MSG_APPLY per owner of the
+// range; each owner runs the kernel over the part of the range that lies in
+// its own blocks and answers with a single MSG_APPLY_RESPONSE holding the
+// partial result, which the caller combines. Blocks of the caller and of
+// node-local owners (-s) are scanned in place. Only partial results cross
+// the network, whatever the size of the range.
+
+typedef struct {
+    int64_t arg;
+    int32_t op;
+    int32_t length;  // bytes from msg->position, the global start
+} dms_apply_args_t;
+
+typedef struct {
+    int64_t value;
+    int32_t status;
+} dms_apply_result_t;
+
+static void scan_sum(const byte *data, int posicao, int tamanho, int64_t arg, int64_t *acc) {
+    (void)posicao;
+    (void)arg;
+    int64_t sum = *acc;
+    for (int i = 0; i < tamanho; i += 8) {
+        int64_t value;
+        memcpy(&value, data + i, sizeof(value));
+        sum = (int64_t)((uint64_t)sum + (uint64_t)value);  // wraps like dms_fetch_add()
+    }
+    *acc = sum;
+}
+
+static void scan_min(const byte *data, int posicao, int tamanho, int64_t arg, int64_t *acc) {
+    (void)posicao;
+    (void)arg;
+    for (int i = 0; i < tamanho; i += 8) {
+        int64_t value;
+        memcpy(&value, data + i, sizeof(value));
+        if (value < *acc) *acc = value;
+    }
+}
+
+static void scan_max(const byte *data, int posicao, int tamanho, int64_t arg, int64_t *acc) {
+    (void)posicao;
+    (void)arg;
+    for (int i = 0; i < tamanho; i += 8) {
+        int64_t value;
+        memcpy(&value, data + i, sizeof(value));
+        if (value > *acc) *acc = value;
+    }
+}
+
+static void scan_count(const byte *data, int posicao, int tamanho, int64_t arg, int64_t *acc) {
+    (void)posicao;
+    for (int i = 0; i < tamanho; i += 8) {
+        int64_t value;
+        memcpy(&value, data + i, sizeof(value));
+        *acc += value == arg;
+    }
+}
+
+// Owners scan their blocks in increasing order, so the first hit stays
+static void scan_find(const byte *data, int posicao, int tamanho, int64_t arg, int64_t *acc) {
+    if (*acc >= 0) {
+        return;
+    }
+    const byte *hit = memchr(data, (int)(arg & 0xFF), tamanho);
+    if (hit) {
+        *acc = posicao + (hit - data);
+    }
+}
+
+static int64_t combine_sum(int64_t a, int64_t b) {
+    return (int64_t)((uint64_t)a + (uint64_t)b);
+}
+
+static int64_t combine_min(int64_t a, int64_t b) {
+    return a < b ? a : b;
+}
+
+static int64_t combine_max(int64_t a, int64_t b) {
+    return a > b ? a : b;
+}
+
+static int64_t combine_find(int64_t a, int64_t b) {
+    if (a < 0) return b;
+    if (b < 0) return a;
+    return a < b ? a : b;
+}
+
+// Function pointers cannot be shipped: every process must register the same
+// kernels under the same ids
+static dms_kernel_t kernels[DMS_MAX_KERNELS] = {
+    [DMS_APPLY_SUM] = {8, 0, scan_sum, combine_sum},
+    [DMS_APPLY_MIN] = {8, INT64_MAX, scan_min, combine_min},
+    [DMS_APPLY_MAX] = {8, INT64_MIN, scan_max, combine_max},
+    [DMS_APPLY_COUNT] = {8, 0, scan_count, combine_sum},
+    [DMS_APPLY_FIND] = {1, -1, scan_find, combine_find},
+};
+
+int dms_register_kernel(int op, const dms_kernel_t *kernel) {
+    if (op < DMS_APPLY_FIRST_KERNEL || op >= DMS_MAX_KERNELS) {
+        return DMS_ERROR_INVALID_POSITION;
+    }
+    if (!kernel || !kernel->scan || !kernel->combine || kernel->width <= 0) {
+        return DMS_ERROR_INVALID_SIZE;
+    }
+    kernels[op] = *kernel;
+    return DMS_SUCCESS;
+}
+
+static const dms_kernel_t *find_kernel(int op) {
+    if (op < 0 || op >= DMS_MAX_KERNELS || !kernels[op].scan) {
+        return NULL;
+    }
+    return &kernels[op];
+}
+
+// First block of 'owner' at or after block_id
+static int64_t first_block_of(int owner, int64_t block_id) {
+    int n = dms_ctx->config.n;
+    return block_id + ((owner - block_id % n) % n + n) % n;
+}
+
+// Runs the kernel over the blocks of 'owner' in [posicao, posicao + tamanho);
+// the owner itself, or a process on the same node with -s
+static int scan_owned(const dms_kernel_t *kernel, int owner, int posicao, int tamanho, int64_t arg,
+                      int64_t *acc) {
+    int t = dms_ctx->config.t;
+    int64_t end = (int64_t)posicao + tamanho;
+    byte snapshot[MAX_BLOCK_SIZE];
+
+    for (int64_t block_id = first_block_of(owner, posicao / t); block_id * t < end;
+         block_id += dms_ctx->config.n) {
+        int64_t start = block_id * t > posicao ? block_id * t : posicao;
+        int64_t stop = (block_id + 1) * t < end ? (block_id + 1) * t : end;
+        int offset = (int)(start - block_id * t);
+        int size = (int)(stop - start);
+
+        const byte *data;
+        if (dms_ctx->shm_peer_blocks) {
+            // Node-local writers may be storing concurrently
+            int result = shm_read((int)block_id, offset, snapshot, size);
+            if (result != DMS_SUCCESS) {
+                return result;
+            }
+            data = snapshot;
+        } else {
+            byte *local_data = get_local_block_data((int)block_id);
+            if (!local_data) {
+                return DMS_ERROR_BLOCK_NOT_FOUND;
+            }
+            data = local_data + offset;
+        }
+        kernel->scan(data, (int)start, size, arg, acc);
+    }
+    return DMS_SUCCESS;
+}
+
+int dms_apply(int posicao, int tamanho, int op, int64_t arg, int64_t *resultado) {
+    if (!dms_ctx || posicao < 0 || tamanho <= 0 || !resultado) {
+        return DMS_ERROR_INVALID_POSITION;
+    }
+
+    const dms_kernel_t *kernel = find_kernel(op);
+    if (!kernel) {
+        return DMS_ERROR_INVALID_POSITION;
+    }
+
+    int64_t total_memory_size = (int64_t)dms_ctx->config.k * dms_ctx->config.t;
+    if ((int64_t)posicao + tamanho > total_memory_size) {
+        return DMS_ERROR_INVALID_SIZE;
+    }
+
+    // Elements never straddle two owners
+    if (posicao % kernel->width != 0 || tamanho % kernel->width != 0 ||
+        dms_ctx->config.t % kernel->width != 0) {
+        return DMS_ERROR_INVALID_SIZE;
+    }
+
+    // Our unreleased writes must reach the owners before they scan
+    if (dms_ctx->config.coherence == DMS_COHERENCE_RELEASE) {
+        int result = rc_flush_diffs();
+        if (result != DMS_SUCCESS) {
+            return result;
+        }
+    }
+
+    int me = dms_ctx->config.process_id;
+    int t = dms_ctx->config.t;
+    int first_block = posicao / t;
+    int last_block = (posicao + tamanho - 1) / t;
+    int owners = last_block - first_block + 1 < dms_ctx->config.n ? last_block - first_block + 1
+                                                                  : dms_ctx->config.n;
+
+    // One request per remote owner, all sent before waiting
+    int remote_owners[MAX_PROCESSES];
+    int num_remote = 0;
+    int result = DMS_SUCCESS;
+    for (int i = 0; i < owners; i++) {
+        int owner = dms_owner_of(first_block + i);
+        if (owner == me || (dms_ctx->shm_peer_blocks && shm_is_node_local(owner))) {
+            continue;
+        }
+
+        dms_message_t request;
+        memset(&request, 0, offsetof(dms_message_t, data));
+        request.type = MSG_APPLY;
+        request.block_id = first_block + i;  // routes the response
+        request.position = posicao;
+        request.size = sizeof(dms_apply_args_t);
+        dms_apply_args_t args = {.arg = arg, .op = op, .length = tamanho};
+        memcpy(request.data, &args, sizeof(args));
+
+        DMS_DEBUG("DEBUG: Process %d shipping operation %d over bytes %d-%d to owner %d\n",
+                  dms_ctx->mpi_rank, op, posicao, posicao + tamanho - 1, owner);
+        result = send_message(owner, &request);
+        if (result != DMS_SUCCESS) {
+            break;
+        }
+        remote_owners[num_remote++] = first_block + i;
+    }
+
+    // Our blocks and node-local ones are scanned while the owners work
+    int64_t acc = kernel->identity;
+    for (int i = 0; i < owners && result == DMS_SUCCESS; i++) {
+        int owner = dms_owner_of(first_block + i);
+        if (owner == me || (dms_ctx->shm_peer_blocks && shm_is_node_local(owner))) {
+            int64_t partial = kernel->identity;
+            result = scan_owned(kernel, owner, posicao, tamanho, arg, &partial);
+            acc = kernel->combine(acc, partial);
+        }
+    }
+
+    // Responses of the requests that went out are collected even after an error
+    for (int i = 0; i < num_remote; i++) {
+        dms_message_t response;
+        int received = wait_for_message(MSG_APPLY_RESPONSE, remote_owners[i], &response);
+        dms_apply_result_t partial;
+        if (received == DMS_SUCCESS) {
+            memcpy(&partial, response.data, sizeof(partial));
+            received = partial.status;
+        }
+        if (received != DMS_SUCCESS) {
+            if (result == DMS_SUCCESS) {
+                result = received;
+            }
+            continue;
+        }
+        acc = kernel->combine(acc, partial.value);
+    }
+
+    if (result == DMS_SUCCESS) {
+        *resultado = acc;
+    }
+    return result;
+}
+
+// Owner side of MSG_APPLY, called from handle_message()
+int handle_apply_request(dms_message_t *msg) {
+    dms_apply_args_t args;
+    memcpy(&args, msg->data, sizeof(args));
+
+    dms_apply_result_t outcome = {0, DMS_SUCCESS};
+    const dms_kernel_t *kernel = find_kernel(args.op);
+    int64_t total_memory_size = (int64_t)dms_ctx->config.k * dms_ctx->config.t;
+    if (!kernel) {
+        // Not registered here
+        outcome.status = DMS_ERROR_INVALID_POSITION;
+    } else if (msg->position < 0 || args.length <= 0 ||
+               (int64_t)msg->position + args.length > total_memory_size) {
+        outcome.status = DMS_ERROR_INVALID_SIZE;
+    } else {
+        outcome.value = kernel->identity;
+        outcome.status = scan_owned(kernel, dms_ctx->config.process_id, msg->position, args.length,
+                                    args.arg, &outcome.value);
+    }
+
+    dms_message_t response;
+    memset(&response, 0, offsetof(dms_message_t, data));
+    response.type = MSG_APPLY_RESPONSE;
+    response.block_id = msg->block_id;
+    response.size = sizeof(outcome);
+    memcpy(response.data, &outcome, sizeof(outcome));
+
+    return send_message(msg->source_pid, &response);
+}
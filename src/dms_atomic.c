@@ -0,0 +1,220 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dms.h"
+
+// Owner-executed atomic operations. The requester sends one MSG_FETCH_ADD,
+// MSG_CAS or MSG_SWAP carrying a dms_atomic_args_t; the owner applies it to
+// its copy of the block, invalidates the other caches exactly like a write
+// when the value changed, and answers with MSG_ATOMIC_RESPONSE. Every update
+// costs one round trip and is serialized by the owner.
+
+static int64_t load_value(const byte *target, int width) {
+    if (width == 4) {
+        int32_t value;
+        memcpy(&value, target, sizeof(value));
+        return value;
+    }
+    int64_t value;
+    memcpy(&value, target, sizeof(value));
+    return value;
+}
+
+static void store_value(byte *target, int width, int64_t value) {
+    if (width == 4) {
+        int32_t narrow = (int32_t)value;
+        memcpy(target, &narrow, sizeof(narrow));
+    } else {
+        memcpy(target, &value, sizeof(value));
+    }
+}
+
+// Positions may be unaligned, so the value is copied in and out. Callers
+// guarantee exclusive access to the target (owner thread or shm seqlock).
+int atomic_apply(message_type_t op, byte *target, const dms_atomic_args_t *args,
+                 dms_atomic_result_t *result) {
+    int64_t previous = load_value(target, args->width);
+    int64_t updated;
+
+    switch (op) {
+        case MSG_FETCH_ADD:
+            // Wrap around like the hardware would instead of overflowing
+            if (args->width == 4) {
+                updated = (int32_t)((uint32_t)previous + (uint32_t)args->operand);
+            } else {
+                updated = (int64_t)((uint64_t)previous + (uint64_t)args->operand);
+            }
+            break;
+        case MSG_CAS:
+            updated = previous == args->expected ? args->operand : previous;
+            break;
+        case MSG_SWAP:
+            updated = args->operand;
+            break;
+        default:
+            return DMS_ERROR_INVALID_POSITION;
+    }
+
+    if (args->width == 4) {
+        updated = (int32_t)updated;
+    }
+
+    result->previous = previous;
+    result->changed = updated != previous;
+    if (result->changed) {
+        store_value(target, args->width, updated);
+    }
+
+    return DMS_SUCCESS;
+}
+
+static int dms_atomic(message_type_t op, int posicao, const dms_atomic_args_t *args, int64_t *anterior) {
+    if (!dms_ctx || posicao < 0) {
+        return DMS_ERROR_INVALID_POSITION;
+    }
+
+    if (args->width != 4 && args->width != 8) {
+        return DMS_ERROR_INVALID_SIZE;
+    }
+
+    int64_t total_memory_size = (int64_t)dms_ctx->config.k * dms_ctx->config.t;
+    if ((int64_t)posicao + args->width > total_memory_size) {
+        return DMS_ERROR_INVALID_SIZE;
+    }
+
+    int block_id = get_block_from_position(posicao);
+    int offset_in_block = get_offset_in_block(posicao);
+    if (offset_in_block + args->width > dms_ctx->config.t) {
+        // A value split between two owners cannot be updated atomically
+        return DMS_ERROR_INVALID_POSITION;
+    }
+
+    if (is_readonly_range(posicao, args->width)) {
+        return DMS_ERROR_READONLY;
+    }
+
+    int me = dms_ctx->config.process_id;
+    int owner = get_block_owner(block_id);
+    dms_atomic_result_t outcome;
+    int result;
+
+    if (dms_ctx->config.transport == DMS_TRANSPORT_RMA && owner == me) {
+        // Invalidates the RMA sharers itself
+        result = rma_atomic_block(op, block_id, offset_in_block, args, &outcome);
+    } else if (dms_ctx->shm_peer_blocks && shm_is_node_local(owner)) {
+        result = shm_atomic(op, block_id, offset_in_block, args, &outcome);
+        if (result == DMS_SUCCESS && outcome.changed) {
+            invalidate_cache_and_wait_acks(block_id, offset_in_block, args->width, me);
+        }
+    } else if (owner == me) {
+        byte *local_data = get_local_block_data(block_id);
+        if (!local_data) {
+            return DMS_ERROR_BLOCK_NOT_FOUND;
+        }
+        result = atomic_apply(op, local_data + offset_in_block, args, &outcome);
+        if (result == DMS_SUCCESS && outcome.changed) {
+            invalidate_cache_and_wait_acks(block_id, offset_in_block, args->width, me);
+        }
+    } else {
+        DMS_DEBUG("DEBUG: Process %d sending atomic operation %d on block %d to owner %d\n",
+                  dms_ctx->mpi_rank, op, block_id, owner);
+
+        // Under release consistency our unreleased writes to the block must
+        // reach the owner before the operation reads it
+        cache_entry_t *entry = find_cache_entry(block_id);
+        if (entry && entry->dirty) {
+            result = rc_writeback_entry(entry);
+            if (result != DMS_SUCCESS) {
+                return result;
+            }
+        }
+
+        dms_message_t request;
+        memset(&request, 0, sizeof(request));
+        request.type = op;
+        request.block_id = block_id;
+        request.position = offset_in_block;
+        request.size = sizeof(dms_atomic_args_t);
+        memcpy(request.data, args, sizeof(dms_atomic_args_t));
+
+        result = send_message(owner, &request);
+        if (result != DMS_SUCCESS) {
+            return result;
+        }
+
+        dms_message_t response;
+        result = wait_for_message(MSG_ATOMIC_RESPONSE, block_id, &response);
+        if (result != DMS_SUCCESS) {
+            return result;
+        }
+        memcpy(&outcome, response.data, sizeof(outcome));
+
+        if (outcome.changed) {
+            invalidate_cache_entry(block_id);
+        }
+    }
+
+    if (result == DMS_SUCCESS && anterior) {
+        *anterior = outcome.previous;
+    }
+
+    return result;
+}
+
+int dms_fetch_add(int posicao, int tamanho, int64_t valor, int64_t *anterior) {
+    dms_atomic_args_t args = {.operand = valor, .expected = 0, .width = tamanho};
+    return dms_atomic(MSG_FETCH_ADD, posicao, &args, anterior);
+}
+
+int dms_cas(int posicao, int tamanho, int64_t esperado, int64_t novo, int64_t *anterior) {
+    dms_atomic_args_t args = {.operand = novo, .expected = esperado, .width = tamanho};
+    return dms_atomic(MSG_CAS, posicao, &args, anterior);
+}
+
+int dms_swap(int posicao, int tamanho, int64_t novo, int64_t *anterior) {
+    dms_atomic_args_t args = {.operand = novo, .expected = 0, .width = tamanho};
+    return dms_atomic(MSG_SWAP, posicao, &args, anterior);
+}
+
+// Owner side of MSG_FETCH_ADD / MSG_CAS / MSG_SWAP, called from handle_message()
+int handle_atomic_request(dms_message_t *msg) {
+    dms_atomic_args_t args;
+    memcpy(&args, msg->data, sizeof(args));
+
+    byte *local_data = get_local_block_data(msg->block_id);
+    if (!local_data || (args.width != 4 && args.width != 8) ||
+        msg->position < 0 || msg->position + args.width > dms_ctx->config.t) {
+        return DMS_ERROR_BLOCK_NOT_FOUND;
+    }
+
+    dms_atomic_result_t outcome;
+    int result;
+    if (dms_ctx->config.transport == DMS_TRANSPORT_RMA) {
+        result = rma_atomic_block(msg->type, msg->block_id, msg->position, &args, &outcome);
+    } else if (dms_ctx->shm_peer_blocks) {
+        result = shm_atomic(msg->type, msg->block_id, msg->position, &args, &outcome);
+    } else {
+        result = atomic_apply(msg->type, local_data + msg->position, &args, &outcome);
+    }
+    if (result != DMS_SUCCESS) {
+        return result;
+    }
+
+    if (outcome.changed && dms_ctx->config.transport != DMS_TRANSPORT_RMA) {
+        int invalidate_result = invalidate_cache_and_wait_acks(msg->block_id, msg->position, args.width,
+                                                              msg->source_pid);
+        if (invalidate_result != DMS_SUCCESS) {
+            return invalidate_result;
+        }
+    }
+
+    dms_message_t response;
+    memset(&response, 0, sizeof(response));
+    response.type = MSG_ATOMIC_RESPONSE;
+    response.block_id = msg->block_id;
+    response.size = sizeof(outcome);
+    memcpy(response.data, &outcome, sizeof(outcome));
+
+    return send_message(msg->source_pid, &response);
+}
@@ -0,0 +1,211 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "dms.h"
+
+// Block payload encoding for MSG_READ_RESPONSE. The receiver knows the
+// decoded length from its request: a payload of exactly that length holds
+// the raw bytes, a shorter one starts with a dms_payload_encoding_t:
+//
+//   DMS_PAYLOAD_ZERO  nothing follows, the range is all zero
+//   DMS_PAYLOAD_RLE   PackBits: a control byte c < 128 is followed by c + 1
+//                     literal bytes, c >= 128 by one byte repeated c - 126 times
+//
+// Raw payloads therefore cost nothing extra. Zero ranges are always elided.
+// RLE is only tried when 'compress' gives the link speed, and only used
+// while the measured ratio and encoding speed make it cheaper than sending
+// the raw bytes over that link.
+
+#define RLE_MIN_RUN 3       // shorter repeats stay in a literal run
+#define RLE_MAX_RUN 129
+#define RLE_MAX_LITERAL 128
+#define RLE_PROBE_INTERVAL 16  // payloads between re-measurements once RLE is off
+
+// 16 bytes per step with SSE2, one word at a time otherwise. The scan stops
+// at the first 64-byte chunk holding a non-zero byte.
+int payload_is_zero(const byte *data, int size) {
+    int i = 0;
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 64 <= size; i += 64) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(data + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(data + i + 16));
+        __m128i c = _mm_loadu_si128((const __m128i *)(data + i + 32));
+        __m128i d = _mm_loadu_si128((const __m128i *)(data + i + 48));
+        __m128i any = _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(any, zero)) != 0xFFFF) {
+            return 0;
+        }
+    }
+#else
+    for (; i + (int)sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        if (word) {
+            return 0;
+        }
+    }
+#endif
+    for (; i < size; i++) {
+        if (data[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Returns the encoded size, or -1 as soon as it would reach 'capacity'
+static int rle_encode(const byte *src, int size, byte *dest, int capacity) {
+    int out = 0;
+    int i = 0;
+    while (i < size) {
+        int run = 1;
+        while (i + run < size && run < RLE_MAX_RUN && src[i + run] == src[i]) {
+            run++;
+        }
+
+        if (run >= RLE_MIN_RUN) {
+            if (out + 2 >= capacity) {
+                return -1;
+            }
+            dest[out++] = (byte)(run + 126);
+            dest[out++] = src[i];
+            i += run;
+            continue;
+        }
+
+        // Literal run up to the next repeat worth encoding
+        int start = i;
+        int length = 0;
+        while (i < size && length < RLE_MAX_LITERAL) {
+            if (i + RLE_MIN_RUN <= size && src[i] == src[i + 1] && src[i] == src[i + 2]) {
+                break;
+            }
+            i++;
+            length++;
+        }
+        if (out + 1 + length >= capacity) {
+            return -1;
+        }
+        dest[out++] = (byte)(length - 1);
+        memcpy(dest + out, src + start, length);
+        out += length;
+    }
+    return out;
+}
+
+static int rle_decode(const byte *src, int encoded_size, byte *dest, int size) {
+    int in = 0, out = 0;
+    while (in < encoded_size) {
+        int control = src[in++];
+        if (control < 128) {
+            int length = control + 1;
+            if (in + length > encoded_size || out + length > size) {
+                return DMS_ERROR_INVALID_SIZE;
+            }
+            memcpy(dest + out, src + in, length);
+            in += length;
+            out += length;
+        } else {
+            int run = control - 126;
+            if (in >= encoded_size || out + run > size) {
+                return DMS_ERROR_INVALID_SIZE;
+            }
+            memset(dest + out, src[in++], run);
+            out += run;
+        }
+    }
+    return out == size ? DMS_SUCCESS : DMS_ERROR_INVALID_SIZE;
+}
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// RLE pays off when the transfer time it saves on the link exceeds the
+// time spent encoding: (1 - ratio) * encode speed > link speed
+static int rle_worth_trying(int size) {
+    if (dms_ctx->config.compress <= 0 || size < DMS_COMPRESS_MIN_PAYLOAD) {
+        return 0;
+    }
+    if (dms_ctx->rle_samples == 0 || ++dms_ctx->rle_skipped >= RLE_PROBE_INTERVAL) {
+        return 1;
+    }
+
+    double link_bytes_per_us = dms_ctx->config.compress;  // 1 MB/s = 1 byte/us
+    return (1.0 - dms_ctx->rle_ratio) * dms_ctx->rle_bytes_per_us > link_bytes_per_us;
+}
+
+static void rle_measure(int size, int encoded, double elapsed_us) {
+    double ratio = encoded < 0 ? 1.0 : (double)encoded / size;
+    double speed = size / (elapsed_us > 0.01 ? elapsed_us : 0.01);
+
+    // Exponential moving averages, the first sample taken as is
+    if (dms_ctx->rle_samples == 0) {
+        dms_ctx->rle_ratio = ratio;
+        dms_ctx->rle_bytes_per_us = speed;
+    } else {
+        dms_ctx->rle_ratio = 0.875 * dms_ctx->rle_ratio + 0.125 * ratio;
+        dms_ctx->rle_bytes_per_us = 0.875 * dms_ctx->rle_bytes_per_us + 0.125 * speed;
+    }
+    dms_ctx->rle_samples++;
+    dms_ctx->rle_skipped = 0;
+}
+
+// Encodes 'size' bytes into dest, which has room for 'size' bytes.
+// Returns the payload size.
+int payload_encode(const byte *src, int size, byte *dest) {
+    int encoded_size = size;
+
+    if (size > 1 && payload_is_zero(src, size)) {
+        dest[0] = DMS_PAYLOAD_ZERO;
+        encoded_size = 1;
+    } else if (rle_worth_trying(size)) {
+        double start = now_us();
+        // Must end up shorter than the raw bytes to be told apart from them
+        int encoded = rle_encode(src, size, dest + 1, size - 1);
+        rle_measure(size, encoded, now_us() - start);
+        if (encoded > 0) {
+            dest[0] = DMS_PAYLOAD_RLE;
+            encoded_size = 1 + encoded;
+        }
+    }
+
+    if (encoded_size == size) {
+        memcpy(dest, src, size);
+    }
+
+    dms_ctx->payload_bytes += size;
+    dms_ctx->payload_bytes_sent += encoded_size;
+    return encoded_size;
+}
+
+int payload_decode(const byte *src, int encoded_size, byte *dest, int size) {
+    if (encoded_size == size) {
+        memcpy(dest, src, size);
+        return DMS_SUCCESS;
+    }
+    if (encoded_size < 1 || encoded_size > size) {
+        return DMS_ERROR_INVALID_SIZE;
+    }
+
+    switch (src[0]) {
+        case DMS_PAYLOAD_ZERO:
+            memset(dest, 0, size);
+            return DMS_SUCCESS;
+        case DMS_PAYLOAD_RLE:
+            return rle_decode(src + 1, encoded_size - 1, dest, size);
+        default:
+            return DMS_ERROR_INVALID_SIZE;
+    }
+}
@@ -8,10 +8,6 @@
 
 #include "dms.h"
 
-static inline size_t effective_size(const dms_message_t *msg) {
-    return offsetof(dms_message_t, data) + msg->size;
-}
-
 int send_message(int target_pid, dms_message_t *msg) {
     if (!dms_ctx || !msg || target_pid < 0 || target_pid >= dms_ctx->config.n) {
         return DMS_ERROR_INVALID_PROCESS;
@@ -20,17 +16,7 @@ int send_message(int target_pid, dms_message_t *msg) {
     msg->source_pid = dms_ctx->mpi_rank;
     msg->target_pid = target_pid;
 
-    size_t nbytes = effective_size(msg);
-
-    pthread_mutex_lock(&dms_ctx->mpi_mutex);
-    int result = MPI_Send(msg, nbytes, MPI_BYTE, target_pid, 0, MPI_COMM_WORLD);
-    pthread_mutex_unlock(&dms_ctx->mpi_mutex);
-
-    if (result != MPI_SUCCESS) {
-        return DMS_ERROR_COMMUNICATION;
-    }
-
-    return DMS_SUCCESS;
+    return transport_send(target_pid, msg);
 }
 
 int receive_message(dms_message_t *msg) {
@@ -38,86 +24,238 @@ int receive_message(dms_message_t *msg) {
         return DMS_ERROR_COMMUNICATION;
     }
 
-    MPI_Status status;
-    int flag;
+    return transport_receive(msg);
+}
 
-    pthread_mutex_lock(&dms_ctx->mpi_mutex);
+static int is_response(const dms_message_t *msg) {
+    return msg->type == MSG_READ_RESPONSE ||
+           msg->type == MSG_WRITE_RESPONSE ||
+           msg->type == MSG_INVALIDATE_ACK ||
+           msg->type == MSG_ATOMIC_RESPONSE ||
+           msg->type == MSG_DIFF_ACK ||
+           msg->type == MSG_WRITE_NOTICE_ACK ||
+           msg->type == MSG_LOCK_GRANT ||
+           msg->type == MSG_BARRIER_RELEASE ||
+           msg->type == MSG_APPLY_RESPONSE ||
+           msg->type == MSG_COPY_DATA_ACK ||
+           msg->type == MSG_COPY_DONE;
+}
 
-    int result = MPI_Iprobe(MPI_ANY_SOURCE, 0, MPI_COMM_WORLD, &flag, &status);
-    if (result != MPI_SUCCESS) {
-        pthread_mutex_unlock(&dms_ctx->mpi_mutex);
-        return DMS_ERROR_COMMUNICATION;
+// A wait nested inside handle_message() (e.g. a write request served while
+// waiting for our own response) may receive the response an outer wait is
+// looking for; keep it instead of dropping it.
+static void defer_message(const dms_message_t *msg) {
+    deferred_message_t *entry = malloc(sizeof(deferred_message_t));
+    if (!entry) {
+        return;
     }
+    memcpy(&entry->msg, msg, dms_message_size(msg));
+    entry->next = dms_ctx->deferred;
+    dms_ctx->deferred = entry;
+}
 
-    if (!flag) {
-        pthread_mutex_unlock(&dms_ctx->mpi_mutex);
-        return DMS_ERROR_COMMUNICATION;
+static int take_deferred(message_type_t type, int block_id, dms_message_t *out) {
+    deferred_message_t **link = &dms_ctx->deferred;
+    while (*link) {
+        deferred_message_t *entry = *link;
+        if (entry->msg.type == type && entry->msg.block_id == block_id) {
+            memcpy(out, &entry->msg, dms_message_size(&entry->msg));
+            *link = entry->next;
+            free(entry);
+            return DMS_SUCCESS;
+        }
+        link = &entry->next;
     }
+    return DMS_ERROR_COMMUNICATION;
+}
 
-    int nbytes;
-    MPI_Get_count(&status, MPI_BYTE, &nbytes);
+// Wait for a response of the given type and block, serving every other
+// incoming request meanwhile. Gives up after timeout_ms milliseconds without
+// traffic; a negative timeout waits forever (lock grants, barriers).
+int wait_for_message_timeout(message_type_t type, int block_id, dms_message_t *response,
+                             int timeout_ms) {
+    if (!dms_ctx || !response) {
+        return DMS_ERROR_COMMUNICATION;
+    }
 
-    result = MPI_Recv(msg, nbytes, MPI_BYTE, status.MPI_SOURCE, 0, MPI_COMM_WORLD, &status);
+    // Our request, and replies produced while serving others below, must not
+    // stay in an aggregation outbox while we wait or after we return
+    transport_flush();
 
-    pthread_mutex_unlock(&dms_ctx->mpi_mutex);
+    int attempts = 0;
 
-    if (result != MPI_SUCCESS) {
-        return DMS_ERROR_COMMUNICATION;
+    while (timeout_ms < 0 || attempts < timeout_ms) {
+        // Checked on every pass: a request served below may defer our response
+        if (take_deferred(type, block_id, response) == DMS_SUCCESS) {
+            transport_flush();
+            return DMS_SUCCESS;
+        }
+        if (receive_message(response) == DMS_SUCCESS) {
+            if (response->type == type && response->block_id == block_id) {
+                transport_flush();
+                return DMS_SUCCESS;
+            }
+            if (is_response(response)) {
+                defer_message(response);
+            } else {
+                handle_message(response);
+            }
+        } else {
+            dms_ctx->transport->ops->wait(1000);  // up to 1ms
+            attempts++;
+        }
     }
 
-    return DMS_SUCCESS;
+    return DMS_ERROR_COMMUNICATION;
+}
+
+int wait_for_message(message_type_t type, int block_id, dms_message_t *response) {
+    return wait_for_message_timeout(type, block_id, response, 1000);  // 1 second timeout
+}
+
+// Byte range messages (MSG_READ_REQUEST, MSG_INVALIDATE) carry the offset
+// in 'position' and the length as an int32 payload; without a payload they
+// cover the whole block
+static void set_message_range(dms_message_t *msg, int offset, int length) {
+    int32_t value = length;
+    msg->position = offset;
+    msg->size = sizeof(value);
+    memcpy(msg->data, &value, sizeof(value));
+}
+
+static void get_message_range(const dms_message_t *msg, int *offset, int *length) {
+    int32_t value;
+    *offset = 0;
+    *length = dms_ctx->config.t;
+    if (msg->size < (int)sizeof(value)) {
+        return;
+    }
+    memcpy(&value, msg->data, sizeof(value));
+    if (msg->position >= 0 && value > 0 && msg->position + value <= dms_ctx->config.t) {
+        *offset = msg->position;
+        *length = value;
+    }
 }
 
 int request_block_from_owner(int block_id, int owner_pid) {
-    if (!dms_ctx || block_id < 0 || block_id >= dms_ctx->config.k) {
+    if (!dms_ctx) {
         return DMS_ERROR_INVALID_POSITION;
     }
+    return request_sectors_from_owner(block_id, owner_pid, get_sector_mask(0, dms_ctx->config.t));
+}
+
+// Fetches the sectors from the first to the last one in 'sectors' in a
+// single request. Sectors we already hold are not overwritten: under
+// release consistency they may carry our unreleased writes.
+int request_sectors_from_owner(int block_id, int owner_pid, uint64_t sectors) {
+    if (!dms_ctx || block_id < 0 || block_id >= dms_ctx->config.k || sectors == 0) {
+        return DMS_ERROR_INVALID_POSITION;
+    }
+
+    if (dms_ctx->config.transport == DMS_TRANSPORT_RMA) {
+        return rma_fetch_block(block_id, owner_pid);
+    }
+
+    int result = send_read_request(block_id, owner_pid, sectors);
+    if (result != DMS_SUCCESS) {
+        return result;
+    }
+    return receive_read_response(block_id, sectors);
+}
+
+// First half of request_sectors_from_owner(): several requests may be sent
+// before their responses are collected (le_v())
+int send_read_request(int block_id, int owner_pid, uint64_t sectors) {
+    int sector = dms_ctx->config.sector;
+    int first = __builtin_ctzll(sectors);
+    int last = MAX_SECTORS - 1 - __builtin_clzll(sectors);
 
     dms_message_t request;
-    memset(&request, 0, sizeof(request));
+    memset(&request, 0, offsetof(dms_message_t, data));
     request.type = MSG_READ_REQUEST;
     request.block_id = block_id;
-    request.size = 0;
+    set_message_range(&request, first * sector, (last - first + 1) * sector);
 
-    int result = send_message(owner_pid, &request);
-    if (result != DMS_SUCCESS) {
-        return result;
+    int slot = block_id % CACHE_SIZE;
+    dms_ctx->fetch_block[slot] = block_id;
+    dms_ctx->fetch_stamp[slot] = dms_ctx->num_unordered;
+
+    return send_message(owner_pid, &request);
+}
+
+// Whether an invalidation of block_id that did not come from its owner was
+// handled since the request was sent: the response may then predate the
+// write, since only the owner's own messages are ordered with it
+static int response_overtaken(int block_id) {
+    int slot = block_id % CACHE_SIZE;
+    if (dms_ctx->fetch_block[slot] != block_id) {
+        return 1;  // another outstanding request took the slot
     }
 
-    // Wait for response with timeout, actively handling other messages
-    dms_message_t response;
-    int attempts = 0;
-    const int max_attempts = 1000;  // 1 second timeout
+    uint32_t since = dms_ctx->num_unordered - dms_ctx->fetch_stamp[slot];
+    if (since > INVALIDATION_LOG) {
+        return 1;
+    }
+    for (uint32_t i = dms_ctx->fetch_stamp[slot]; i != dms_ctx->num_unordered; i++) {
+        if (dms_ctx->unordered_invalidations[i % INVALIDATION_LOG] == block_id) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Second half: waits for the response and fills the cache entry
+int receive_read_response(int block_id, uint64_t sectors) {
+    int sector = dms_ctx->config.sector;
+    int first = __builtin_ctzll(sectors);
+    int last = MAX_SECTORS - 1 - __builtin_clzll(sectors);
 
-    while (attempts < max_attempts) {
-        result = receive_message(&response);
+    dms_message_t response;
+    int result = wait_for_message(MSG_READ_RESPONSE, block_id, &response);
+    while (result == DMS_SUCCESS && response_overtaken(block_id)) {
+        DMS_DEBUG("DEBUG: Process %d asking again for block %d, invalidated while in flight\n",
+                  dms_ctx->mpi_rank, block_id);
+        result = send_read_request(block_id, dms_owner_of(block_id), sectors);
         if (result == DMS_SUCCESS) {
-            if (response.type == MSG_READ_RESPONSE && response.block_id == block_id) {
-                cache_entry_t *cache_entry = allocate_cache_entry(block_id);
-                if (!cache_entry) {
-                    return DMS_ERROR_MEMORY;
-                }
+            result = wait_for_message(MSG_READ_RESPONSE, block_id, &response);
+        }
+    }
+    if (result != DMS_SUCCESS) {
+        return result;
+    }
 
-                pthread_mutex_lock(&cache_entry->mutex);
-                memcpy(cache_entry->data, response.data, dms_ctx->config.t);
-                cache_entry->valid = 1;
-                pthread_mutex_unlock(&cache_entry->mutex);
+    int length = (last - first + 1) * sector;
+    byte data[MAX_BLOCK_SIZE];
+    if (response.position != first * sector ||
+        payload_decode(response.data, response.size, data, length) != DMS_SUCCESS) {
+        return DMS_ERROR_COMMUNICATION;
+    }
 
-                return DMS_SUCCESS;
-            }
-            // Handle other messages that aren't our response
-            if (response.type != MSG_READ_RESPONSE &&
-                response.type != MSG_WRITE_RESPONSE &&
-                response.type != MSG_INVALIDATE_ACK) {
-                handle_message(&response);
-            }
-        } else {
-            usleep(1000);  // 1ms delay
-            attempts++;
+    cache_entry_t *cache_entry = find_cache_entry(block_id);
+    if (!cache_entry) {
+        cache_entry = allocate_cache_entry(block_id);
+    }
+    if (!cache_entry) {
+        return DMS_ERROR_MEMORY;
+    }
+
+    pthread_mutex_lock(&cache_entry->mutex);
+    for (int offset = response.position; offset < response.position + length; offset += sector) {
+        uint64_t bit = (uint64_t)1 << (offset / sector);
+        if (cache_entry->sectors & bit) {
+            continue;
         }
+        memcpy(cache_entry->data + offset, data + (offset - response.position), sector);
+        if (cache_entry->dirty) {
+            // Not written by us, so it must not show up in the diff
+            memcpy(cache_entry->twin + offset, cache_entry->data + offset, sector);
+        }
+        cache_entry->sectors |= bit;
     }
+    cache_entry->valid = 1;
+    pthread_mutex_unlock(&cache_entry->mutex);
 
-    return DMS_ERROR_COMMUNICATION;
+    return DMS_SUCCESS;
 }
 
 int handle_message(dms_message_t *msg) {
@@ -125,54 +263,72 @@ int handle_message(dms_message_t *msg) {
         return DMS_ERROR_COMMUNICATION;
     }
 
-    if (msg->type == MSG_READ_RESPONSE ||
-        msg->type == MSG_WRITE_RESPONSE ||
-        msg->type == MSG_INVALIDATE_ACK) {
+    if (is_response(msg)) {
         return DMS_SUCCESS;
     }
 
-    printf("DEBUG: Process %d handling message type %d from process %d for block %d\n",
-           dms_ctx->mpi_rank, msg->type, msg->source_pid, msg->block_id);
+    DMS_DEBUG("DEBUG: Process %d handling message type %d from process %d for block %d\n",
+              dms_ctx->mpi_rank, msg->type, msg->source_pid, msg->block_id);
 
     switch (msg->type) {
         case MSG_READ_REQUEST: {
-            printf("DEBUG: Process %d processing read request\n", dms_ctx->mpi_rank);
+            DMS_DEBUG("DEBUG: Process %d processing read request\n", dms_ctx->mpi_rank);
             byte *local_data = get_local_block_data(msg->block_id);
             if (!local_data) {
-                printf("DEBUG: Process %d did not found block %d locally\n", dms_ctx->mpi_rank, msg->block_id);
+                DMS_DEBUG("DEBUG: Process %d did not found block %d locally\n", dms_ctx->mpi_rank, msg->block_id);
                 return DMS_ERROR_BLOCK_NOT_FOUND;
             }
 
+            int offset, length;
+            get_message_range(msg, &offset, &length);
+            sharers_note_reader(msg->block_id, msg->source_pid);
+
             dms_message_t response;
-            memset(&response, 0, sizeof(response));
+            memset(&response, 0, offsetof(dms_message_t, data));
             response.type = MSG_READ_RESPONSE;
             response.block_id = msg->block_id;
-            response.size = dms_ctx->config.t;
-            memcpy(response.data, local_data, dms_ctx->config.t);
+            response.position = offset;
+            response.size = length;
+            if (dms_ctx->shm_peer_blocks) {
+                // Consistent snapshot under the seqlock first
+                byte snapshot[MAX_BLOCK_SIZE];
+                shm_read(msg->block_id, offset, snapshot, length);
+                response.size = payload_encode(snapshot, length, response.data);
+            } else {
+                response.size = payload_encode(local_data + offset, length, response.data);
+            }
 
-            printf("DEBUG: Process %d sending read response\n", dms_ctx->mpi_rank);
+            DMS_DEBUG("DEBUG: Process %d sending read response\n", dms_ctx->mpi_rank);
             return send_message(msg->source_pid, &response);
         }
 
         case MSG_WRITE_REQUEST: {
-            printf("DEBUG: Process %d processing write request\n", dms_ctx->mpi_rank);
+            DMS_DEBUG("DEBUG: Process %d processing write request\n", dms_ctx->mpi_rank);
             byte *local_data = get_local_block_data(msg->block_id);
             if (!local_data) {
-                printf("DEBUG: Process %d did not found block %d locally\n", dms_ctx->mpi_rank, msg->block_id);
+                DMS_DEBUG("DEBUG: Process %d did not found block %d locally\n", dms_ctx->mpi_rank, msg->block_id);
                 return DMS_ERROR_BLOCK_NOT_FOUND;
             }
 
             int offset = msg->position;
             int size = msg->size;
-            if (offset >= 0 && offset + size <= dms_ctx->config.t) {
-                memcpy(local_data + offset, msg->data, size);
-                printf("DEBUG: Process %d updated block %d\n", dms_ctx->mpi_rank, msg->block_id);
+            if (offset >= 0 && size > 0 && offset + size <= dms_ctx->config.t) {
+                if (dms_ctx->shm_peer_blocks) {
+                    shm_write(msg->block_id, offset, msg->data, size);
+                } else {
+                    memcpy(local_data + offset, msg->data, size);
+                }
+                DMS_DEBUG("DEBUG: Process %d updated block %d\n", dms_ctx->mpi_rank, msg->block_id);
+            } else {
+                offset = 0;
+                size = dms_ctx->config.t;
             }
 
-            printf("DEBUG: Process %d invalidating caches and waiting for ACKs\n", dms_ctx->mpi_rank);
-            int invalidate_result = invalidate_cache_and_wait_acks(msg->block_id, msg->source_pid);
+            DMS_DEBUG("DEBUG: Process %d invalidating caches and waiting for ACKs\n", dms_ctx->mpi_rank);
+            int invalidate_result = invalidate_cache_and_wait_acks(msg->block_id, offset, size,
+                                                                   msg->source_pid);
             if (invalidate_result != DMS_SUCCESS) {
-                printf("DEBUG: Process %d failed to invalidate caches\n", dms_ctx->mpi_rank);
+                DMS_DEBUG("DEBUG: Process %d failed to invalidate caches\n", dms_ctx->mpi_rank);
                 return invalidate_result;
             }
 
@@ -182,19 +338,38 @@ int handle_message(dms_message_t *msg) {
             response.block_id = msg->block_id;
             response.size = 0;
 
-            printf("DEBUG: Process %d sending write response after invalidation complete\n", dms_ctx->mpi_rank);
+            DMS_DEBUG("DEBUG: Process %d sending write response after invalidation complete\n", dms_ctx->mpi_rank);
             return send_message(msg->source_pid, &response);
         }
 
         case MSG_INVALIDATE: {
-            printf("DEBUG: Process %d processing invalidate request\n", dms_ctx->mpi_rank);
+            DMS_DEBUG("DEBUG: Process %d processing invalidate request\n", dms_ctx->mpi_rank);
             cache_entry_t *entry = find_cache_entry(msg->block_id);
-            if (entry) {
+            if (entry && dms_ctx->config.coherence == DMS_COHERENCE_RELEASE) {
+                // Applied lazily, at the next dms_acquire()
+                entry->noticed = 1;
+            } else if (entry) {
+                // Only the written sectors go; the rest of the block stays cached
+                int offset, length;
+                get_message_range(msg, &offset, &length);
                 pthread_mutex_lock(&entry->mutex);
-                entry->valid = 0;
+                entry->sectors &= ~get_sector_mask(offset, length);
+                if (entry->sectors == 0) {
+                    entry->valid = 0;
+                }
                 entry->dirty = 0;
                 pthread_mutex_unlock(&entry->mutex);
-                printf("DEBUG: Process %d invalidated cache for block %d\n", dms_ctx->mpi_rank, msg->block_id);
+                DMS_DEBUG("DEBUG: Process %d invalidated bytes %d-%d of block %d\n", dms_ctx->mpi_rank,
+                          offset, offset + length - 1, msg->block_id);
+            }
+            if (msg->source_pid != get_block_owner(msg->block_id)) {
+                dms_ctx->unordered_invalidations[dms_ctx->num_unordered++ % INVALIDATION_LOG] = msg->block_id;
+            }
+
+            // Our part of the tree acknowledges together with us
+            int relay_result = relay_invalidation(msg);
+            if (relay_result != DMS_SUCCESS) {
+                return relay_result;
             }
 
             dms_message_t response;
@@ -203,62 +378,61 @@ int handle_message(dms_message_t *msg) {
             response.block_id = msg->block_id;
             response.size = 0;
 
-            printf("DEBUG: Process %d sending invalidate ack\n", dms_ctx->mpi_rank);
+            DMS_DEBUG("DEBUG: Process %d sending invalidate ack\n", dms_ctx->mpi_rank);
             return send_message(msg->source_pid, &response);
         }
 
-        default:
-            printf("DEBUG: Process %d doesn't recognize message type %d\n", dms_ctx->mpi_rank, msg->type);
-            break;
-    }
+        case MSG_FETCH_ADD:
+        case MSG_CAS:
+        case MSG_SWAP:
+            DMS_DEBUG("DEBUG: Process %d processing atomic operation\n", dms_ctx->mpi_rank);
+            return handle_atomic_request(msg);
 
-    return DMS_SUCCESS;
-}
+        case MSG_DIFF:
+            DMS_DEBUG("DEBUG: Process %d applying diff to block %d\n", dms_ctx->mpi_rank, msg->block_id);
+            return handle_diff(msg);
 
-int invalidate_cache_and_wait_acks(int block_id, int requester_pid) {
-    if (!dms_ctx) {
-        return DMS_ERROR_COMMUNICATION;
-    }
+        case MSG_WRITE_NOTICE:
+            DMS_DEBUG("DEBUG: Process %d received write notices\n", dms_ctx->mpi_rank);
+            return handle_write_notice(msg);
 
-    dms_message_t invalidate_msg;
-    memset(&invalidate_msg, 0, sizeof(invalidate_msg));
-    invalidate_msg.type = MSG_INVALIDATE;
-    invalidate_msg.block_id = block_id;
-    invalidate_msg.size = 0;
-
-    int expected_acks = 0;
-    for (int i = 0; i < dms_ctx->config.n; i++) {
-        if (i != dms_ctx->mpi_rank && i != requester_pid) {
-            if (send_message(i, &invalidate_msg) == DMS_SUCCESS) {
-                expected_acks++;
-            }
-        }
-    }
+        case MSG_LOCK_REQUEST:
+            DMS_DEBUG("DEBUG: Process %d queueing lock %d for process %d\n",
+                      dms_ctx->mpi_rank, msg->block_id, msg->source_pid);
+            return handle_lock_request(msg);
 
-    if (expected_acks == 0) {
-        return DMS_SUCCESS;
-    }
+        case MSG_UNLOCK:
+            DMS_DEBUG("DEBUG: Process %d releasing lock %d of process %d\n",
+                      dms_ctx->mpi_rank, msg->block_id, msg->source_pid);
+            return handle_unlock(msg);
 
-    int received_acks = 0;
-    int attempts = 0;
-    const int max_attempts = 1000;
-    dms_message_t response;
+        case MSG_BARRIER_ENTER:
+            DMS_DEBUG("DEBUG: Process %d counting process %d at barrier %d\n",
+                      dms_ctx->mpi_rank, msg->source_pid, msg->block_id);
+            return handle_barrier_enter(msg);
 
-    while (received_acks < expected_acks && attempts < max_attempts) {
-        if (receive_message(&response) == DMS_SUCCESS) {
-            if (response.type == MSG_INVALIDATE_ACK && response.block_id == block_id) {
-                received_acks++;
-            } else {
-                handle_message(&response);
-            }
-        } else {
-            usleep(1000);
-            attempts++;
-        }
-    }
+        case MSG_APPLY:
+            DMS_DEBUG("DEBUG: Process %d running operation over its blocks\n", dms_ctx->mpi_rank);
+            return handle_apply_request(msg);
 
-    if (received_acks < expected_acks) {
-        return DMS_ERROR_COMMUNICATION;
+        case MSG_COPY:
+            DMS_DEBUG("DEBUG: Process %d streaming its part of a copy\n", dms_ctx->mpi_rank);
+            return handle_copy_request(msg);
+
+        case MSG_COPY_DATA:
+            return handle_copy_data(msg);
+
+        case MSG_FILL:
+            DMS_DEBUG("DEBUG: Process %d filling its part of a range\n", dms_ctx->mpi_rank);
+            return handle_fill_request(msg);
+
+        case MSG_INVALIDATE_RANGE:
+            DMS_DEBUG("DEBUG: Process %d invalidating a range of blocks\n", dms_ctx->mpi_rank);
+            return handle_invalidate_range(msg);
+
+        default:
+            DMS_DEBUG("DEBUG: Process %d doesn't recognize message type %d\n", dms_ctx->mpi_rank, msg->type);
+            break;
     }
 
     return DMS_SUCCESS;
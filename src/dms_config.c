@@ -5,6 +5,34 @@
 
 #include "dms.h"
 
+static int parse_transport(const char *value, dms_transport_t *transport) {
+    if (strcmp(value, "message") == 0 || strcmp(value, "msg") == 0) {
+        *transport = DMS_TRANSPORT_MESSAGE;
+    } else if (strcmp(value, "rma") == 0) {
+        *transport = DMS_TRANSPORT_RMA;
+    } else {
+        fprintf(stderr, "Error: Unknown transport '%s'\n", value);
+        return DMS_ERROR_INVALID_PROCESS;
+    }
+    return DMS_SUCCESS;
+}
+
+static int parse_coherence(const char *value, dms_coherence_t *coherence) {
+    if (strcmp(value, "strict") == 0) {
+        *coherence = DMS_COHERENCE_STRICT;
+    } else if (strcmp(value, "release") == 0) {
+        *coherence = DMS_COHERENCE_RELEASE;
+    } else {
+        fprintf(stderr, "Error: Unknown coherence mode '%s'\n", value);
+        return DMS_ERROR_INVALID_PROCESS;
+    }
+    return DMS_SUCCESS;
+}
+
+static const char *transport_name(dms_transport_t transport) {
+    return transport == DMS_TRANSPORT_RMA ? "rma" : "message";
+}
+
 int load_config_from_file(const char *filename, dms_config_t *config) {
     if (!filename || !config) {
         return DMS_ERROR_INVALID_PROCESS;
@@ -21,6 +49,13 @@ int load_config_from_file(const char *filename, dms_config_t *config) {
     config->k = 0;
     config->t = 0;
     config->process_id = -1;
+    config->transport = DMS_TRANSPORT_MESSAGE;
+    config->shm = 0;
+    config->batch = DMS_BATCH_DEFAULT;
+    config->coherence = DMS_COHERENCE_STRICT;
+    config->sector = 0;
+    config->compress = 0;
+    config->map = 0;
 
     while (fgets(line, sizeof(line), file)) {
         // Remove newline
@@ -41,6 +76,28 @@ int load_config_from_file(const char *filename, dms_config_t *config) {
                 config->t = atoi(value);
             } else if (strcmp(key, "process_id") == 0 || strcmp(key, "pid") == 0) {
                 config->process_id = atoi(value);
+            } else if (strcmp(key, "debug") == 0) {
+                dms_debug = atoi(value);
+            } else if (strcmp(key, "shm") == 0) {
+                config->shm = atoi(value);
+            } else if (strcmp(key, "batch") == 0) {
+                config->batch = atoi(value);
+            } else if (strcmp(key, "sector") == 0) {
+                config->sector = atoi(value);
+            } else if (strcmp(key, "compress") == 0) {
+                config->compress = atoi(value);
+            } else if (strcmp(key, "map") == 0) {
+                config->map = atoi(value);
+            } else if (strcmp(key, "coherence") == 0) {
+                if (parse_coherence(value, &config->coherence) != DMS_SUCCESS) {
+                    fclose(file);
+                    return DMS_ERROR_INVALID_PROCESS;
+                }
+            } else if (strcmp(key, "transport") == 0) {
+                if (parse_transport(value, &config->transport) != DMS_SUCCESS) {
+                    fclose(file);
+                    return DMS_ERROR_INVALID_PROCESS;
+                }
             }
         }
     }
@@ -66,9 +123,16 @@ int parse_command_line_config(int argc, char *argv[], dms_config_t *config) {
     config->k = 1000;        // 1000 blocks
     config->t = 4096;        // 4KB blocks
     config->process_id = 0;  // default to process 0
+    config->transport = DMS_TRANSPORT_MESSAGE;
+    config->shm = 0;
+    config->batch = DMS_BATCH_DEFAULT;
+    config->coherence = DMS_COHERENCE_STRICT;
+    config->sector = 0;      // whole blocks
+    config->compress = 0;    // zero elision only
+    config->map = 0;
 
     int opt;
-    while ((opt = getopt(argc, argv, "n:k:t:p:h")) != -1) {
+    while ((opt = getopt(argc, argv, "n:k:t:p:m:b:c:S:z:Msqh")) != -1) {
         switch (opt) {
             case 'n':
                 config->n = atoi(optarg);
@@ -82,6 +146,34 @@ int parse_command_line_config(int argc, char *argv[], dms_config_t *config) {
             case 'p':
                 config->process_id = atoi(optarg);
                 break;
+            case 'm':
+                if (parse_transport(optarg, &config->transport) != DMS_SUCCESS) {
+                    return DMS_ERROR_INVALID_PROCESS;
+                }
+                break;
+            case 'b':
+                config->batch = atoi(optarg);
+                break;
+            case 'c':
+                if (parse_coherence(optarg, &config->coherence) != DMS_SUCCESS) {
+                    return DMS_ERROR_INVALID_PROCESS;
+                }
+                break;
+            case 'S':
+                config->sector = atoi(optarg);
+                break;
+            case 'z':
+                config->compress = atoi(optarg);
+                break;
+            case 'M':
+                config->map = 1;
+                break;
+            case 's':
+                config->shm = 1;
+                break;
+            case 'q':
+                dms_debug = 0;
+                break;
             case 'h':
                 print_usage(argv[0]);
                 exit(0);
@@ -108,6 +200,14 @@ void print_usage(const char *program_name) {
     printf("  -k <num>     Number of blocks (default: 1000)\n");
     printf("  -t <num>     Block size in bytes (default: 4096)\n");
     printf("  -p <num>     Process ID (0 to n-1)\n");
+    printf("  -m <mode>    Transport: message or rma (default: message)\n");
+    printf("  -b <bytes>   Message aggregation threshold, 0 disables (default: %d)\n", DMS_BATCH_DEFAULT);
+    printf("  -c <mode>    Coherence: strict or release (default: strict)\n");
+    printf("  -S <bytes>   Cache sector size, divides -t (default: whole block)\n");
+    printf("  -z <MB/s>    Link speed for adaptive RLE of read responses, 0 disables (default: 0)\n");
+    printf("  -M           Pointer access through dms_map(), needs -c release and -t = page size\n");
+    printf("  -s           Direct shared-memory access to node-local blocks\n");
+    printf("  -q           Quiet: disable protocol DEBUG output\n");
     printf("  -h           Show this help message\n");
     printf("\nExample:\n");
     printf("  %s -n 4 -k 1000 -t 4096 -p 0\n", program_name);
@@ -123,8 +223,27 @@ void print_config(const dms_config_t *config) {
     printf("  Blocks (k): %d\n", config->k);
     printf("  Block size (t): %d bytes\n", config->t);
     printf("  Process ID: %d\n", config->process_id);
-    printf("  Total memory: %d bytes (%.2f MB)\n",
-           config->k * config->t,
-           (config->k * config->t) / (1024.0 * 1024.0));
+    printf("  Transport: %s\n", transport_name(config->transport));
+    printf("  Coherence: %s\n", config->coherence == DMS_COHERENCE_RELEASE ? "release" : "strict");
+    printf("  Shared-memory fast path: %s\n", config->shm ? "on" : "off");
+    if (config->batch > 0) {
+        printf("  Message aggregation: up to %d bytes\n", config->batch);
+    } else {
+        printf("  Message aggregation: off\n");
+    }
+    if (config->sector > 0 && config->sector < config->t) {
+        printf("  Cache sectors: %d bytes (%d per block)\n", config->sector, config->t / config->sector);
+    } else {
+        printf("  Cache sectors: whole block\n");
+    }
+    if (config->compress > 0) {
+        printf("  Read response RLE: adaptive for a %d MB/s link\n", config->compress);
+    } else {
+        printf("  Read response RLE: off (zero blocks still elided)\n");
+    }
+    printf("  Pointer access (dms_map): %s\n", config->map ? "on" : "off");
+    printf("  Total memory: %lld bytes (%.2f MB)\n",
+           (long long)config->k * config->t,
+           ((long long)config->k * config->t) / (1024.0 * 1024.0));
     printf("  Local blocks per process: ~%d\n", config->k / config->n);
 }
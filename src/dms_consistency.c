@@ -0,0 +1,429 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dms.h"
+
+// Lazy release consistency (coherence = release). Writes to remote blocks
+// go to the cached copy; the first write to a block saves a twin of it.
+// dms_release() compares each dirty block with its twin, ships the changed
+// byte runs to the owners (MSG_DIFF) and then tells every other process
+// which blocks changed (MSG_WRITE_NOTICE). Notices only mark cache entries;
+// they are applied by dms_acquire(). Several processes may write disjoint
+// parts of a block concurrently: the owner merges their diffs.
+//
+// dms_unlock() and dms_barrier() (dms_sync.c) ship the diffs the same way
+// but carry the notices on the synchronization messages instead of
+// broadcasting them, and the lock grant or barrier release applies them.
+//
+// Pages written through dms_map() (dms_map.c) take part like cache entries:
+// their diffs go out with the others and notices drop them at the acquire.
+
+#define DIFF_RUN_HEADER (2 * (int)sizeof(int32_t))  // offset, length
+
+int rc_init(void) {
+    if (dms_ctx->config.coherence != DMS_COHERENCE_RELEASE) {
+        return DMS_SUCCESS;
+    }
+
+    dms_ctx->written_flags = calloc(dms_ctx->config.k, sizeof(byte));
+    if (!dms_ctx->written_flags) {
+        return DMS_ERROR_MEMORY;
+    }
+    return DMS_SUCCESS;
+}
+
+void rc_cleanup(void) {
+    if (!dms_ctx) return;
+
+    for (int i = 0; i < CACHE_SIZE; i++) {
+        free(dms_ctx->cache[i].twin);
+        dms_ctx->cache[i].twin = NULL;
+    }
+    free(dms_ctx->written_blocks);
+    free(dms_ctx->written_flags);
+    dms_ctx->written_blocks = NULL;
+    dms_ctx->written_flags = NULL;
+    dms_ctx->num_written_blocks = 0;
+    dms_ctx->written_capacity = 0;
+}
+
+// Remembers that block_id needs a write notice at the next release
+int rc_note_written(int block_id) {
+    if (dms_ctx->written_flags[block_id]) {
+        return DMS_SUCCESS;
+    }
+
+    if (dms_ctx->num_written_blocks == dms_ctx->written_capacity) {
+        int capacity = dms_ctx->written_capacity ? dms_ctx->written_capacity * 2 : 64;
+        int *blocks = realloc(dms_ctx->written_blocks, capacity * sizeof(int));
+        if (!blocks) {
+            return DMS_ERROR_MEMORY;
+        }
+        dms_ctx->written_blocks = blocks;
+        dms_ctx->written_capacity = capacity;
+    }
+
+    dms_ctx->written_flags[block_id] = 1;
+    dms_ctx->written_blocks[dms_ctx->num_written_blocks++] = block_id;
+    return DMS_SUCCESS;
+}
+
+int rc_write_cached(int block_id, int owner, int offset, const byte *src, int size) {
+    // Partially written sectors need their current contents, and a sector
+    // the twin does not know about would hide our write from the diff
+    cache_entry_t *entry = find_cache_entry(block_id);
+    uint64_t needed = get_sector_mask(offset, size);
+    if (!entry || (entry->sectors & needed) != needed) {
+        uint64_t missing = needed & ~(entry ? entry->sectors : 0);
+        int result = request_sectors_from_owner(block_id, owner, missing);
+        if (result != DMS_SUCCESS) {
+            return result;
+        }
+        entry = find_cache_entry(block_id);
+        if (!entry) {
+            return DMS_ERROR_MEMORY;
+        }
+    }
+
+    pthread_mutex_lock(&entry->mutex);
+    if (!entry->dirty) {
+        if (!entry->twin) {
+            entry->twin = malloc(dms_ctx->config.t);
+            if (!entry->twin) {
+                pthread_mutex_unlock(&entry->mutex);
+                return DMS_ERROR_MEMORY;
+            }
+        }
+        memcpy(entry->twin, entry->data, dms_ctx->config.t);
+        entry->dirty = 1;
+    }
+    memcpy(entry->data + offset, src, size);
+    pthread_mutex_unlock(&entry->mutex);
+
+    return rc_note_written(block_id);
+}
+
+static int send_diff_message(int owner, dms_message_t *msg, int *messages) {
+    int result = send_message(owner, msg);
+    if (result == DMS_SUCCESS) {
+        (*messages)++;
+    }
+    msg->size = 0;
+    return result;
+}
+
+// Sends the runs that differ from the twin; adds the number of MSG_DIFF
+// messages, each of which is acknowledged by the owner
+int rc_send_diff(int block_id, const byte *data, const byte *twin, int *messages) {
+    int t = dms_ctx->config.t;
+    int owner = get_block_owner(block_id);
+
+    dms_message_t msg;
+    memset(&msg, 0, offsetof(dms_message_t, data));
+    msg.type = MSG_DIFF;
+    msg.block_id = block_id;
+    msg.size = 0;
+
+    int i = 0;
+    while (i < t) {
+        if (data[i] == twin[i]) {
+            i++;
+            continue;
+        }
+
+        // Runs stop at the first unchanged byte: that byte may have been
+        // written concurrently by another process under a different lock
+        int start = i, last = i;
+        while (last + 1 < t && data[last + 1] != twin[last + 1]) {
+            last++;
+        }
+        i = last + 1;
+
+        // A run longer than the space left is split across messages
+        int remaining = last - start + 1;
+        while (remaining > 0) {
+            int space = MAX_BLOCK_SIZE - msg.size - DIFF_RUN_HEADER;
+            if (space <= 0) {
+                if (send_diff_message(owner, &msg, messages) != DMS_SUCCESS) {
+                    return DMS_ERROR_COMMUNICATION;
+                }
+                continue;
+            }
+
+            int32_t run[2] = {start, remaining < space ? remaining : space};
+            memcpy(msg.data + msg.size, run, DIFF_RUN_HEADER);
+            memcpy(msg.data + msg.size + DIFF_RUN_HEADER, data + start, run[1]);
+            msg.size += DIFF_RUN_HEADER + run[1];
+            start += run[1];
+            remaining -= run[1];
+        }
+    }
+
+    if (msg.size > 0 && send_diff_message(owner, &msg, messages) != DMS_SUCCESS) {
+        return DMS_ERROR_COMMUNICATION;
+    }
+    return DMS_SUCCESS;
+}
+
+int rc_wait_diff_acks(int block_id, int messages) {
+    dms_message_t response;
+    for (int i = 0; i < messages; i++) {
+        int result = wait_for_message(MSG_DIFF_ACK, block_id, &response);
+        if (result != DMS_SUCCESS) {
+            return result;
+        }
+    }
+    return DMS_SUCCESS;
+}
+
+// Writes a single dirty entry back to its owner, used before the entry is
+// evicted or invalidated
+int rc_writeback_entry(cache_entry_t *entry) {
+    if (!entry->dirty) {
+        return DMS_SUCCESS;
+    }
+
+    int messages = 0;
+    int result = rc_send_diff(entry->block_id, entry->data, entry->twin, &messages);
+    if (result == DMS_SUCCESS) {
+        result = rc_wait_diff_acks(entry->block_id, messages);
+    }
+    if (result == DMS_SUCCESS) {
+        entry->dirty = 0;
+    }
+    return result;
+}
+
+static void clear_written(void) {
+    for (int i = 0; i < dms_ctx->num_written_blocks; i++) {
+        dms_ctx->written_flags[dms_ctx->written_blocks[i]] = 0;
+    }
+    dms_ctx->num_written_blocks = 0;
+}
+
+static int send_write_notices(void) {
+    int n = dms_ctx->config.n;
+    int me = dms_ctx->config.process_id;
+
+    for (int first = 0; first < dms_ctx->num_written_blocks; first += NOTICES_PER_MESSAGE) {
+        int count = dms_ctx->num_written_blocks - first;
+        if (count > NOTICES_PER_MESSAGE) {
+            count = NOTICES_PER_MESSAGE;
+        }
+
+        dms_message_t notice;
+        memset(&notice, 0, offsetof(dms_message_t, data));
+        notice.type = MSG_WRITE_NOTICE;
+        notice.block_id = dms_ctx->written_blocks[first];
+        notice.size = count * (int)sizeof(int32_t);
+        for (int i = 0; i < count; i++) {
+            int32_t block_id = dms_ctx->written_blocks[first + i];
+            memcpy(notice.data + i * sizeof(int32_t), &block_id, sizeof(block_id));
+        }
+
+        int expected = 0;
+        for (int pid = 0; pid < n; pid++) {
+            if (pid != me && send_message(pid, &notice) == DMS_SUCCESS) {
+                expected++;
+            }
+        }
+
+        dms_message_t response;
+        for (int i = 0; i < expected; i++) {
+            int result = wait_for_message(MSG_WRITE_NOTICE_ACK, notice.block_id, &response);
+            if (result != DMS_SUCCESS) {
+                return result;
+            }
+        }
+    }
+
+    clear_written();
+    return DMS_SUCCESS;
+}
+
+// Ships every diff first and collects the acknowledgements afterwards
+int rc_flush_diffs(void) {
+    int messages[CACHE_SIZE];
+    for (int i = 0; i < CACHE_SIZE; i++) {
+        messages[i] = 0;
+        cache_entry_t *entry = &dms_ctx->cache[i];
+        if (entry->valid && entry->dirty) {
+            int result = rc_send_diff(entry->block_id, entry->data, entry->twin, &messages[i]);
+            if (result != DMS_SUCCESS) {
+                return result;
+            }
+        }
+    }
+
+    for (int i = 0; i < CACHE_SIZE; i++) {
+        cache_entry_t *entry = &dms_ctx->cache[i];
+        if (entry->valid && entry->dirty) {
+            int result = rc_wait_diff_acks(entry->block_id, messages[i]);
+            if (result != DMS_SUCCESS) {
+                return result;
+            }
+            entry->dirty = 0;
+        }
+    }
+    return map_flush_diffs();
+}
+
+// Moves our pending notices into a synchronization message. When they do
+// not fit, 'position' is set and the receivers drop their whole cache.
+void rc_pack_notices(dms_message_t *msg) {
+    msg->size = 0;
+    msg->position = 0;
+    if (dms_ctx->config.coherence != DMS_COHERENCE_RELEASE) {
+        return;
+    }
+
+    int count = dms_ctx->num_written_blocks;
+    if (count > NOTICES_PER_MESSAGE) {
+        msg->position = 1;
+        count = 0;
+    }
+    for (int i = 0; i < count; i++) {
+        int32_t block_id = dms_ctx->written_blocks[i];
+        memcpy(msg->data + i * sizeof(int32_t), &block_id, sizeof(block_id));
+    }
+    msg->size = count * (int)sizeof(int32_t);
+    clear_written();
+}
+
+int dms_release(void) {
+    if (!dms_ctx) {
+        return DMS_ERROR_COMMUNICATION;
+    }
+    if (dms_ctx->config.coherence != DMS_COHERENCE_RELEASE) {
+        return DMS_SUCCESS;
+    }
+
+    int result = rc_flush_diffs();
+    if (result != DMS_SUCCESS) {
+        return result;
+    }
+
+    // Owners have applied every diff, so a process that acts on a notice
+    // fetches the new contents
+    return send_write_notices();
+}
+
+static int drop_noticed(void) {
+    int dropped = 0;
+    for (int i = 0; i < CACHE_SIZE; i++) {
+        cache_entry_t *entry = &dms_ctx->cache[i];
+        if (!entry->valid || !entry->noticed) {
+            continue;
+        }
+
+        // Our own unreleased writes to the block are merged at the owner first
+        int result = rc_writeback_entry(entry);
+        if (result != DMS_SUCCESS) {
+            return result;
+        }
+
+        pthread_mutex_lock(&entry->mutex);
+        entry->valid = 0;
+        entry->noticed = 0;
+        pthread_mutex_unlock(&entry->mutex);
+        dropped++;
+    }
+
+    DMS_DEBUG("DEBUG: Process %d acquire dropped %d stale cache entries\n",
+              dms_ctx->mpi_rank, dropped);
+
+    return map_drop_noticed();
+}
+
+int dms_acquire(void) {
+    if (!dms_ctx) {
+        return DMS_ERROR_COMMUNICATION;
+    }
+    if (dms_ctx->config.coherence != DMS_COHERENCE_RELEASE) {
+        return DMS_SUCCESS;
+    }
+
+    // Notices that already arrived are pending here
+    handle_incoming_messages();
+
+    return drop_noticed();
+}
+
+// Acquire side of a lock grant or barrier release packed by rc_pack_notices()
+int rc_apply_notices(const dms_message_t *msg) {
+    if (dms_ctx->config.coherence != DMS_COHERENCE_RELEASE) {
+        return DMS_SUCCESS;
+    }
+
+    if (msg->position) {
+        for (int i = 0; i < CACHE_SIZE; i++) {
+            if (dms_ctx->cache[i].valid) {
+                dms_ctx->cache[i].noticed = 1;
+            }
+        }
+        map_notice_all();
+    } else {
+        int count = msg->size / (int)sizeof(int32_t);
+        for (int i = 0; i < count; i++) {
+            int32_t block_id;
+            memcpy(&block_id, msg->data + i * sizeof(int32_t), sizeof(block_id));
+            cache_entry_t *entry = find_cache_entry(block_id);
+            if (entry) {
+                entry->noticed = 1;
+            }
+            map_notice(block_id);
+        }
+    }
+
+    return drop_noticed();
+}
+
+int handle_diff(dms_message_t *msg) {
+    byte *local_data = get_local_block_data(msg->block_id);
+    if (!local_data) {
+        return DMS_ERROR_BLOCK_NOT_FOUND;
+    }
+
+    int offset = 0;
+    while (offset + DIFF_RUN_HEADER <= msg->size) {
+        int32_t run[2];
+        memcpy(run, msg->data + offset, DIFF_RUN_HEADER);
+        offset += DIFF_RUN_HEADER;
+        if (run[0] < 0 || run[1] < 0 || run[0] + run[1] > dms_ctx->config.t ||
+            offset + run[1] > msg->size) {
+            break;
+        }
+        memcpy(local_data + run[0], msg->data + offset, run[1]);
+        offset += run[1];
+    }
+
+    dms_message_t ack;
+    memset(&ack, 0, offsetof(dms_message_t, data));
+    ack.type = MSG_DIFF_ACK;
+    ack.block_id = msg->block_id;
+    ack.size = 0;
+
+    return send_message(msg->source_pid, &ack);
+}
+
+int handle_write_notice(dms_message_t *msg) {
+    int count = msg->size / (int)sizeof(int32_t);
+    for (int i = 0; i < count; i++) {
+        int32_t block_id;
+        memcpy(&block_id, msg->data + i * sizeof(int32_t), sizeof(block_id));
+        cache_entry_t *entry = find_cache_entry(block_id);
+        if (entry) {
+            entry->noticed = 1;
+        }
+        map_notice(block_id);
+    }
+
+    dms_message_t ack;
+    memset(&ack, 0, offsetof(dms_message_t, data));
+    ack.type = MSG_WRITE_NOTICE_ACK;
+    ack.block_id = msg->block_id;
+    ack.size = 0;
+
+    return send_message(msg->source_pid, &ack);
+}
@@ -0,0 +1,456 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dms.h"
+
+// Bulk copy and fill executed by the owners. dms_copy() asks every owner of
+// the source range for its part with one MSG_COPY; a source owner streams
+// its bytes straight to the destination owners in MSG_COPY_DATA chunks,
+// keeping up to COPY_WINDOW of them in flight, and answers MSG_COPY_DONE
+// once all were acknowledged. dms_fill() sends one MSG_FILL per destination
+// owner. The caller only coordinates: when every owner is done it makes one
+// invalidation pass over the destination range (MSG_INVALIDATE_RANGE to each
+// process) in strict mode, or notes the destination blocks for its next
+// release under release consistency.
+
+// Chunks stay well below the eager limit of MPI, so owners streaming to each
+// other never block in MPI_Send
+#define COPY_CHUNK (MAX_BLOCK_SIZE / 4)
+#define COPY_WINDOW 32
+
+typedef struct {
+    int32_t destination;
+    int32_t length;
+} dms_copy_args_t;
+
+typedef struct {
+    int32_t length;
+    int32_t value;
+} dms_fill_args_t;
+
+// The caller waits for owners that may move a lot of data: allow 1 KB/ms
+static int transfer_timeout_ms(int tamanho) {
+    return 1000 + tamanho / 1024;
+}
+
+// First block of 'owner' at or after block_id
+static int first_block_of(int owner, int block_id) {
+    int n = dms_ctx->config.n;
+    return block_id + ((owner - block_id % n) % n + n) % n;
+}
+
+// Owners whose blocks we can store into without a message: ourselves, any
+// owner through the RMA window, node-local owners with -s
+static int stores_directly(int owner) {
+    return owner == dms_ctx->config.process_id || dms_ctx->config.transport == DMS_TRANSPORT_RMA ||
+           (dms_ctx->shm_peer_blocks && shm_is_node_local(owner));
+}
+
+// Stores like escreve() does for such an owner, without invalidating
+static int store_direct(int block_id, int owner, int offset, const byte *src, int size) {
+    if (dms_ctx->config.transport == DMS_TRANSPORT_RMA) {
+        return rma_write_block(block_id, owner, offset, src, size);
+    }
+    if (dms_ctx->shm_peer_blocks) {
+        return shm_write(block_id, offset, src, size);
+    }
+    byte *local_data = get_local_block_data(block_id);
+    if (!local_data) {
+        return DMS_ERROR_BLOCK_NOT_FOUND;
+    }
+    memcpy(local_data + offset, src, size);
+    return DMS_SUCCESS;
+}
+
+static int collect_acks(const int *pending, int count) {
+    int result = DMS_SUCCESS;
+    for (int i = 0; i < count; i++) {
+        dms_message_t ack;
+        int received = wait_for_message(MSG_COPY_DATA_ACK, pending[i], &ack);
+        if (received == DMS_SUCCESS && ack.position != DMS_SUCCESS) {
+            received = ack.position;
+        }
+        if (received != DMS_SUCCESS && result == DMS_SUCCESS) {
+            result = received;
+        }
+    }
+    return result;
+}
+
+// Source owner side: sends our bytes of [origem, origem + tamanho) to the
+// owners of the matching destination bytes
+static int copy_owned(int destino, int origem, int tamanho) {
+    int me = dms_ctx->config.process_id;
+    int t = dms_ctx->config.t;
+    int end = origem + tamanho;
+    byte snapshot[MAX_BLOCK_SIZE];
+    int pending[COPY_WINDOW];
+    int num_pending = 0;
+    int result = DMS_SUCCESS;
+
+    for (int block_id = first_block_of(me, origem / t); (int64_t)block_id * t < end && result == DMS_SUCCESS;
+         block_id += dms_ctx->config.n) {
+        int start = block_id * t > origem ? block_id * t : origem;
+        int stop = (int64_t)(block_id + 1) * t < end ? (block_id + 1) * t : end;
+
+        const byte *data;
+        if (dms_ctx->shm_peer_blocks) {
+            // Node-local writers may be storing concurrently
+            result = shm_read(block_id, start - block_id * t, snapshot, stop - start);
+            if (result != DMS_SUCCESS) {
+                break;
+            }
+            data = snapshot;
+        } else {
+            byte *local_data = get_local_block_data(block_id);
+            if (!local_data) {
+                result = DMS_ERROR_BLOCK_NOT_FOUND;
+                break;
+            }
+            data = local_data + (start - block_id * t);
+        }
+
+        // Pieces that land in a single destination block
+        int position = start;
+        while (position < stop) {
+            int target = destino + (position - origem);
+            int target_block = dms_block_of(target);
+            int offset = dms_offset_of(target);
+            int size = stop - position;
+            if (size > t - offset) size = t - offset;
+            if (size > COPY_CHUNK) size = COPY_CHUNK;
+            const byte *piece = data + (position - start);
+
+            int owner = dms_owner_of(target_block);
+            if (stores_directly(owner)) {
+                result = store_direct(target_block, owner, offset, piece, size);
+            } else {
+                dms_message_t chunk;
+                memset(&chunk, 0, offsetof(dms_message_t, data));
+                chunk.type = MSG_COPY_DATA;
+                chunk.block_id = target_block;
+                chunk.position = offset;
+                chunk.size = size;
+                memcpy(chunk.data, piece, size);
+
+                result = send_message(owner, &chunk);
+                if (result == DMS_SUCCESS) {
+                    pending[num_pending++] = target_block;
+                    if (num_pending == COPY_WINDOW) {
+                        result = collect_acks(pending, num_pending);
+                        num_pending = 0;
+                    }
+                }
+            }
+            if (result != DMS_SUCCESS) {
+                break;
+            }
+            position += size;
+        }
+    }
+
+    int acked = collect_acks(pending, num_pending);
+    return result != DMS_SUCCESS ? result : acked;
+}
+
+// Destination owner side of dms_fill()
+static int fill_owned(int posicao, byte valor, int tamanho) {
+    int t = dms_ctx->config.t;
+    int end = posicao + tamanho;
+    byte pattern[MAX_BLOCK_SIZE];
+    memset(pattern, valor, t);
+
+    for (int block_id = first_block_of(dms_ctx->config.process_id, posicao / t); (int64_t)block_id * t < end;
+         block_id += dms_ctx->config.n) {
+        int start = block_id * t > posicao ? block_id * t : posicao;
+        int stop = (int64_t)(block_id + 1) * t < end ? (block_id + 1) * t : end;
+        int result = store_direct(block_id, dms_ctx->config.process_id, start - block_id * t, pattern,
+                                  stop - start);
+        if (result != DMS_SUCCESS) {
+            return result;
+        }
+    }
+    return DMS_SUCCESS;
+}
+
+// Drops the cached sectors of [posicao, posicao + tamanho) from our cache
+static void drop_cached_range(int posicao, int tamanho) {
+    int t = dms_ctx->config.t;
+    int first_block = posicao / t;
+    int last_block = (posicao + tamanho - 1) / t;
+
+    for (int i = 0; i < CACHE_SIZE; i++) {
+        cache_entry_t *entry = &dms_ctx->cache[i];
+        if (!entry->valid || entry->block_id < first_block || entry->block_id > last_block) {
+            continue;
+        }
+        int start = entry->block_id == first_block ? posicao - first_block * t : 0;
+        int stop = entry->block_id == last_block ? posicao + tamanho - last_block * t : t;
+
+        pthread_mutex_lock(&entry->mutex);
+        entry->sectors &= ~get_sector_mask(start, stop - start);
+        if (entry->sectors == 0) {
+            entry->valid = 0;
+        }
+        entry->dirty = 0;
+        pthread_mutex_unlock(&entry->mutex);
+    }
+}
+
+// Makes the new contents of the destination range visible once every owner
+// has stored its part
+static int finish_write(int posicao, int tamanho) {
+    int t = dms_ctx->config.t;
+    int first_block = posicao / t;
+    int last_block = (posicao + tamanho - 1) / t;
+
+    if (dms_ctx->config.coherence == DMS_COHERENCE_RELEASE) {
+        // Announced by the notices of our next release; our own clean copies
+        // of the range are stale already
+        for (int block_id = first_block; block_id <= last_block; block_id++) {
+            int result = rc_note_written(block_id);
+            if (result != DMS_SUCCESS) {
+                return result;
+            }
+            if (find_cache_entry(block_id)) {
+                invalidate_cache_entry(block_id);
+            }
+        }
+        return DMS_SUCCESS;
+    }
+
+    if (dms_ctx->config.transport == DMS_TRANSPORT_RMA) {
+        return DMS_SUCCESS;  // rma_write_block() flagged the sharers
+    }
+
+    drop_cached_range(posicao, tamanho);
+
+    // One message per process for the whole range instead of one per block
+    dms_message_t invalidate;
+    memset(&invalidate, 0, offsetof(dms_message_t, data));
+    invalidate.type = MSG_INVALIDATE_RANGE;
+    invalidate.block_id = first_block;
+    invalidate.position = posicao;
+    invalidate.size = sizeof(int32_t);
+    int32_t length = tamanho;
+    memcpy(invalidate.data, &length, sizeof(length));
+
+    int expected_acks = 0;
+    for (int i = 0; i < dms_ctx->config.n; i++) {
+        if (i != dms_ctx->config.process_id && send_message(i, &invalidate) == DMS_SUCCESS) {
+            expected_acks++;
+        }
+    }
+
+    DMS_DEBUG("DEBUG: Process %d invalidating bytes %d-%d, waiting for %d ACKs\n",
+              dms_ctx->mpi_rank, posicao, posicao + tamanho - 1, expected_acks);
+
+    for (int i = 0; i < expected_acks; i++) {
+        dms_message_t ack;
+        int result = wait_for_message(MSG_INVALIDATE_ACK, first_block, &ack);
+        if (result != DMS_SUCCESS) {
+            return result;
+        }
+    }
+    return DMS_SUCCESS;
+}
+
+// Sends 'request' to the owners of [posicao, posicao + tamanho) other than
+// us, addressing each with its first block; returns how many were sent
+static int send_to_owners(dms_message_t *request, int posicao, int tamanho, int *routes, int *result) {
+    int t = dms_ctx->config.t;
+    int first_block = posicao / t;
+    int blocks = (posicao + tamanho - 1) / t - first_block + 1;
+    int owners = blocks < dms_ctx->config.n ? blocks : dms_ctx->config.n;
+    int sent = 0;
+
+    *result = DMS_SUCCESS;
+    for (int i = 0; i < owners; i++) {
+        int owner = dms_owner_of(first_block + i);
+        if (owner == dms_ctx->config.process_id) {
+            continue;
+        }
+        request->block_id = first_block + i;
+        *result = send_message(owner, request);
+        if (*result != DMS_SUCCESS) {
+            break;
+        }
+        routes[sent++] = first_block + i;
+    }
+    return sent;
+}
+
+static int collect_done(const int *routes, int count, int tamanho) {
+    int result = DMS_SUCCESS;
+    for (int i = 0; i < count; i++) {
+        dms_message_t done;
+        int received = wait_for_message_timeout(MSG_COPY_DONE, routes[i], &done, transfer_timeout_ms(tamanho));
+        if (received == DMS_SUCCESS && done.position != DMS_SUCCESS) {
+            received = done.position;
+        }
+        if (received != DMS_SUCCESS && result == DMS_SUCCESS) {
+            result = received;
+        }
+    }
+    return result;
+}
+
+static int check_destination(int posicao, int tamanho) {
+    if (posicao < 0 || tamanho <= 0) {
+        return DMS_ERROR_INVALID_POSITION;
+    }
+    int64_t total_memory_size = (int64_t)dms_ctx->config.k * dms_ctx->config.t;
+    if ((int64_t)posicao + tamanho > total_memory_size) {
+        return DMS_ERROR_INVALID_SIZE;
+    }
+    if (is_readonly_range(posicao, tamanho)) {
+        return DMS_ERROR_READONLY;
+    }
+    return DMS_SUCCESS;
+}
+
+// Our unreleased writes must reach the owners before they read the source,
+// and must not land on top of the new destination contents afterwards
+static int flush_unreleased(void) {
+    if (dms_ctx->config.coherence != DMS_COHERENCE_RELEASE) {
+        return DMS_SUCCESS;
+    }
+    return rc_flush_diffs();
+}
+
+int dms_copy(int destino, int origem, int tamanho) {
+    if (!dms_ctx || origem < 0) {
+        return DMS_ERROR_INVALID_POSITION;
+    }
+    int result = check_destination(destino, tamanho);
+    if (result != DMS_SUCCESS) {
+        return result;
+    }
+    if ((int64_t)origem + tamanho > (int64_t)dms_ctx->config.k * dms_ctx->config.t) {
+        return DMS_ERROR_INVALID_SIZE;
+    }
+    // Owners copy in parallel, so overlapping ranges have no defined order
+    if (origem < destino + tamanho && destino < origem + tamanho) {
+        return DMS_ERROR_INVALID_POSITION;
+    }
+
+    result = flush_unreleased();
+    if (result != DMS_SUCCESS) {
+        return result;
+    }
+
+    DMS_DEBUG("DEBUG: Process %d copying %d bytes from %d to %d\n", dms_ctx->mpi_rank, tamanho, origem, destino);
+
+    dms_message_t request;
+    memset(&request, 0, offsetof(dms_message_t, data));
+    request.type = MSG_COPY;
+    request.position = origem;
+    request.size = sizeof(dms_copy_args_t);
+    dms_copy_args_t args = {.destination = destino, .length = tamanho};
+    memcpy(request.data, &args, sizeof(args));
+
+    int routes[MAX_PROCESSES];
+    int sent = send_to_owners(&request, origem, tamanho, routes, &result);
+    if (result == DMS_SUCCESS) {
+        result = copy_owned(destino, origem, tamanho);
+    }
+    int done = collect_done(routes, sent, tamanho);
+    if (result == DMS_SUCCESS) {
+        result = done;
+    }
+
+    return result == DMS_SUCCESS ? finish_write(destino, tamanho) : result;
+}
+
+int dms_fill(int posicao, byte valor, int tamanho) {
+    if (!dms_ctx) {
+        return DMS_ERROR_INVALID_POSITION;
+    }
+    int result = check_destination(posicao, tamanho);
+    if (result != DMS_SUCCESS) {
+        return result;
+    }
+
+    result = flush_unreleased();
+    if (result != DMS_SUCCESS) {
+        return result;
+    }
+
+    DMS_DEBUG("DEBUG: Process %d filling %d bytes at %d with %d\n", dms_ctx->mpi_rank, tamanho, posicao, valor);
+
+    dms_message_t request;
+    memset(&request, 0, offsetof(dms_message_t, data));
+    request.type = MSG_FILL;
+    request.position = posicao;
+    request.size = sizeof(dms_fill_args_t);
+    dms_fill_args_t args = {.length = tamanho, .value = valor};
+    memcpy(request.data, &args, sizeof(args));
+
+    int routes[MAX_PROCESSES];
+    int sent = send_to_owners(&request, posicao, tamanho, routes, &result);
+    if (result == DMS_SUCCESS) {
+        result = fill_owned(posicao, valor, tamanho);
+    }
+    int done = collect_done(routes, sent, tamanho);
+    if (result == DMS_SUCCESS) {
+        result = done;
+    }
+
+    return result == DMS_SUCCESS ? finish_write(posicao, tamanho) : result;
+}
+
+static int reply(const dms_message_t *msg, message_type_t type, int status) {
+    dms_message_t response;
+    memset(&response, 0, offsetof(dms_message_t, data));
+    response.type = type;
+    response.block_id = msg->block_id;
+    response.position = status;
+    return send_message(msg->source_pid, &response);
+}
+
+static int range_is_valid(int posicao, int tamanho) {
+    return posicao >= 0 && tamanho > 0 &&
+           (int64_t)posicao + tamanho <= (int64_t)dms_ctx->config.k * dms_ctx->config.t;
+}
+
+// Source owner side of MSG_COPY, called from handle_message()
+int handle_copy_request(dms_message_t *msg) {
+    dms_copy_args_t args;
+    memcpy(&args, msg->data, sizeof(args));
+
+    int status = DMS_ERROR_INVALID_SIZE;
+    if (range_is_valid(msg->position, args.length) && range_is_valid(args.destination, args.length)) {
+        status = copy_owned(args.destination, msg->position, args.length);
+    }
+    return reply(msg, MSG_COPY_DONE, status);
+}
+
+// Destination owner side of a chunk streamed by a source owner
+int handle_copy_data(dms_message_t *msg) {
+    int status = DMS_ERROR_INVALID_SIZE;
+    if (msg->position >= 0 && msg->size > 0 && msg->position + msg->size <= dms_ctx->config.t) {
+        status = store_direct(msg->block_id, dms_ctx->config.process_id, msg->position, msg->data, msg->size);
+    }
+    return reply(msg, MSG_COPY_DATA_ACK, status);
+}
+
+int handle_fill_request(dms_message_t *msg) {
+    dms_fill_args_t args;
+    memcpy(&args, msg->data, sizeof(args));
+
+    int status = DMS_ERROR_INVALID_SIZE;
+    if (range_is_valid(msg->position, args.length)) {
+        status = fill_owned(msg->position, (byte)args.value, args.length);
+    }
+    return reply(msg, MSG_COPY_DONE, status);
+}
+
+int handle_invalidate_range(dms_message_t *msg) {
+    int32_t length;
+    memcpy(&length, msg->data, sizeof(length));
+    if (range_is_valid(msg->position, length)) {
+        drop_cached_range(msg->position, length);
+    }
+    return reply(msg, MSG_INVALIDATE_ACK, DMS_SUCCESS);
+}
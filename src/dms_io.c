@@ -0,0 +1,182 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "dms.h"
+
+// Bulk load and checkpoint of the whole address space. The file holds the
+// k * t bytes of the shared memory in position order, and every process
+// reads or writes only the blocks it owns, straight into or out of its local
+// storage. With MPI the transfer is one collective MPI_File_read_all /
+// MPI_File_write_all per process through a file view that selects blocks
+// pid, pid + n, pid + 2n, ..., so the aggregate bandwidth grows with n. The
+// loopback transport has no MPI and uses pread/pwrite per block instead.
+// Both calls are collective: every process must call them.
+
+static int count_owned_blocks(void) {
+    int n = dms_ctx->config.n;
+    int me = dms_ctx->config.process_id;
+    return dms_ctx->config.k > me ? (dms_ctx->config.k - me + n - 1) / n : 0;
+}
+
+static int mpi_transfer(const char *caminho, int writing) {
+    int t = dms_ctx->config.t;
+    int owned = count_owned_blocks();
+    int amode = writing ? MPI_MODE_CREATE | MPI_MODE_WRONLY : MPI_MODE_RDONLY;
+
+    pthread_mutex_lock(&dms_ctx->mpi_mutex);
+
+    MPI_File file;
+    if (MPI_File_open(MPI_COMM_WORLD, caminho, amode, MPI_INFO_NULL, &file) != MPI_SUCCESS) {
+        pthread_mutex_unlock(&dms_ctx->mpi_mutex);
+        return DMS_ERROR_IO;
+    }
+
+    // Blocks of t bytes, every n-th one starting at ours
+    MPI_Datatype block_type, file_type;
+    MPI_Type_contiguous(t, MPI_BYTE, &block_type);
+    MPI_Type_commit(&block_type);
+    MPI_Type_vector(owned, 1, dms_ctx->config.n, block_type, &file_type);
+    MPI_Type_commit(&file_type);
+
+    int result = MPI_File_set_view(file, (MPI_Offset)dms_ctx->config.process_id * t, block_type, file_type,
+                                   "native", MPI_INFO_NULL);
+    MPI_Status status;
+    if (result == MPI_SUCCESS && writing) {
+        // Also cuts a longer file left by an earlier checkpoint
+        result = MPI_File_set_size(file, (MPI_Offset)dms_ctx->config.k * t);
+        if (result == MPI_SUCCESS) {
+            result = MPI_File_write_all(file, dms_ctx->blocks, owned, block_type, &status);
+        }
+    } else if (result == MPI_SUCCESS) {
+        result = MPI_File_read_all(file, dms_ctx->blocks, owned, block_type, &status);
+        if (result == MPI_SUCCESS) {
+            // Blocks past the end of a shorter file are zero
+            int bytes = 0;
+            MPI_Get_count(&status, MPI_BYTE, &bytes);
+            if (bytes == MPI_UNDEFINED || bytes < 0) {
+                bytes = 0;
+            }
+            size_t total = (size_t)owned * t;
+            if ((size_t)bytes < total) {
+                memset(dms_ctx->blocks + bytes, 0, total - bytes);
+            }
+        }
+    }
+
+    MPI_Type_free(&file_type);
+    MPI_Type_free(&block_type);
+    MPI_File_close(&file);
+    pthread_mutex_unlock(&dms_ctx->mpi_mutex);
+
+    return result == MPI_SUCCESS ? DMS_SUCCESS : DMS_ERROR_IO;
+}
+
+static int posix_transfer(const char *caminho, int writing) {
+    int t = dms_ctx->config.t;
+    int fd = open(caminho, writing ? O_WRONLY | O_CREAT : O_RDONLY, 0644);
+    if (fd < 0) {
+        return DMS_ERROR_IO;
+    }
+
+    int result = DMS_SUCCESS;
+    if (writing && ftruncate(fd, (off_t)dms_ctx->config.k * t) != 0) {
+        result = DMS_ERROR_IO;
+    }
+
+    for (int block_id = dms_ctx->config.process_id; block_id < dms_ctx->config.k && result == DMS_SUCCESS;
+         block_id += dms_ctx->config.n) {
+        byte *data = dms_owned_data_of(block_id);
+        off_t offset = (off_t)block_id * t;
+        int done = 0;
+        while (done < t) {
+            ssize_t bytes = writing ? pwrite(fd, data + done, t - done, offset + done)
+                                    : pread(fd, data + done, t - done, offset + done);
+            if (bytes < 0 && errno == EINTR) {
+                continue;
+            }
+            if (bytes < 0 || (writing && bytes == 0)) {
+                result = DMS_ERROR_IO;
+                break;
+            }
+            if (bytes == 0) {
+                memset(data + done, 0, t - done);  // past the end of the file
+                break;
+            }
+            done += bytes;
+        }
+    }
+
+    if (close(fd) != 0 && writing && result == DMS_SUCCESS) {
+        result = DMS_ERROR_IO;
+    }
+    return result;
+}
+
+static int transfer(const char *caminho, int writing) {
+    if (dms_ctx->config.transport == DMS_TRANSPORT_LOOPBACK) {
+        return posix_transfer(caminho, writing);
+    }
+    return mpi_transfer(caminho, writing);
+}
+
+int dms_load(const char *caminho) {
+    if (!dms_ctx || !caminho) {
+        return DMS_ERROR_INVALID_POSITION;
+    }
+
+    // Pending writes settle before the storage is replaced
+    int result = dms_barrier();
+    if (result != DMS_SUCCESS) {
+        return result;
+    }
+
+    DMS_DEBUG("DEBUG: Process %d loading its blocks from %s\n", dms_ctx->mpi_rank, caminho);
+    int loaded = transfer(caminho, 0);
+
+    // Every cached copy is stale now
+    dms_flush_local_cache();
+
+    // Replicas are copies of the old contents
+    int refresh = 0;
+    for (int i = 0; i < dms_ctx->num_readonly_regions; i++) {
+        readonly_region_t *region = &dms_ctx->readonly_regions[i];
+        if (region->replicated) {
+            free(region->data);
+            region->data = NULL;
+            region->replicated = 0;
+            refresh = 1;
+        }
+    }
+
+    // Nobody reads before every process has loaded
+    result = dms_barrier();
+    if (result == DMS_SUCCESS && refresh) {
+        result = dms_replicate();
+    }
+    return loaded != DMS_SUCCESS ? loaded : result;
+}
+
+int dms_checkpoint(const char *caminho) {
+    if (!dms_ctx || !caminho) {
+        return DMS_ERROR_INVALID_POSITION;
+    }
+
+    // Under release consistency the barrier also brings every diff home
+    int result = dms_barrier();
+    if (result != DMS_SUCCESS) {
+        return result;
+    }
+
+    DMS_DEBUG("DEBUG: Process %d saving its blocks to %s\n", dms_ctx->mpi_rank, caminho);
+    int saved = transfer(caminho, 1);
+
+    // Nobody writes before every process has saved
+    result = dms_barrier();
+    return saved != DMS_SUCCESS ? saved : result;
+}
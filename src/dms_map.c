@@ -0,0 +1,380 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "dms.h"
+
+// Pointer access to the shared memory (config 'map'). dms_map() reserves
+// k * t bytes of address space with no access rights, one page per block,
+// and a SIGSEGV handler brings pages in as they are touched:
+//
+//   first access to an owned block   the page of our storage file is mapped
+//                                    at the block's address, read-only
+//   first access to a remote block   the block is fetched like le() does and
+//                                    copied into the page, read-only
+//   store to a read-only page        a remote page saves a twin; both kinds
+//                                    become writable and get a write notice
+//
+// Loads and stores that hit an accessible page never enter the library.
+// Stores cannot be seen one at a time, so mapping requires release
+// consistency: at a release, unlock or barrier the written remote pages send
+// their diffs like dirty cache entries and every written page turns read-only
+// again; notices drop remote pages at the next acquire. The handler runs the
+// request path in the faulting thread, so mapped addresses must not be handed
+// to le()/escreve() or other library calls as buffers.
+
+typedef enum {
+    MAP_PAGE_NONE = 0,  // no access
+    MAP_PAGE_READ,
+    MAP_PAGE_WRITE      // written since the last release
+} map_page_state_t;
+
+typedef struct {
+    byte state;    // map_page_state_t
+    byte noticed;  // remote page: dropped at the next acquire
+    byte *twin;    // remote page in MAP_PAGE_WRITE: contents before the first store
+} map_page_t;
+
+struct dms_map_state {
+    byte *base;
+    size_t size;
+    map_page_t *pages;  // one per block, zero pages until touched
+    int *resident;      // remote blocks whose page is accessible
+    int num_resident;
+    int resident_capacity;
+};
+
+static struct sigaction previous_action;
+static pthread_once_t handler_once = PTHREAD_ONCE_INIT;
+static int handler_result = -1;
+
+static byte *page_address(int block_id) {
+    return dms_ctx->map->base + (size_t)block_id * dms_ctx->config.t;
+}
+
+static int is_owned(int block_id) {
+    return get_block_owner(block_id) == dms_ctx->config.process_id;
+}
+
+static int add_resident(int block_id) {
+    dms_map_state_t *map = dms_ctx->map;
+    if (map->num_resident == map->resident_capacity) {
+        int capacity = map->resident_capacity ? map->resident_capacity * 2 : 64;
+        int *resident = realloc(map->resident, capacity * sizeof(int));
+        if (!resident) {
+            return DMS_ERROR_MEMORY;
+        }
+        map->resident = resident;
+        map->resident_capacity = capacity;
+    }
+    map->resident[map->num_resident++] = block_id;
+    return DMS_SUCCESS;
+}
+
+// Owned blocks: the page is our storage, shared with le()/escreve() and the
+// requests we serve, so nothing is copied
+static int map_owned_page(int block_id) {
+    int t = dms_ctx->config.t;
+    off_t offset = (off_t)(block_id / dms_ctx->config.n) * t;
+    void *page = mmap(page_address(block_id), t, PROT_READ, MAP_SHARED | MAP_FIXED,
+                      dms_ctx->storage_fd, offset);
+    return page == MAP_FAILED ? DMS_ERROR_MEMORY : DMS_SUCCESS;
+}
+
+static int fetch_remote_page(int block_id) {
+    int t = dms_ctx->config.t;
+    byte *address = page_address(block_id);
+    const byte *source = NULL;
+    cache_entry_t *entry = NULL;
+
+    if (dms_ctx->num_readonly_regions > 0) {
+        source = get_replica_block_data(block_id);
+    }
+
+    if (!source) {
+        uint64_t all = get_sector_mask(0, t);
+        entry = find_cache_entry(block_id);
+        if (!entry || (entry->sectors & all) != all) {
+            int result = request_sectors_from_owner(block_id, get_block_owner(block_id),
+                                                    all & ~(entry ? entry->sectors : 0));
+            if (result != DMS_SUCCESS) {
+                return result;
+            }
+            entry = find_cache_entry(block_id);
+            if (!entry) {
+                return DMS_ERROR_MEMORY;
+            }
+        }
+        pthread_mutex_lock(&entry->mutex);
+        source = entry->data;
+    }
+
+    int result = DMS_SUCCESS;
+    if (mprotect(address, t, PROT_READ | PROT_WRITE) != 0) {
+        result = DMS_ERROR_MEMORY;
+    } else {
+        memcpy(address, source, t);
+        mprotect(address, t, PROT_READ);
+    }
+
+    if (entry) {
+        pthread_mutex_unlock(&entry->mutex);
+    }
+    if (result == DMS_SUCCESS) {
+        result = add_resident(block_id);
+    }
+    return result;
+}
+
+// A store to a read-only page
+static int make_writable(int block_id) {
+    map_page_t *page = &dms_ctx->map->pages[block_id];
+    int t = dms_ctx->config.t;
+    byte *address = page_address(block_id);
+
+    if (!is_owned(block_id)) {
+        page->twin = malloc(t);
+        if (!page->twin) {
+            return DMS_ERROR_MEMORY;
+        }
+        memcpy(page->twin, address, t);
+    }
+
+    if (mprotect(address, t, PROT_READ | PROT_WRITE) != 0) {
+        free(page->twin);
+        page->twin = NULL;
+        return DMS_ERROR_MEMORY;
+    }
+    page->state = MAP_PAGE_WRITE;
+    return rc_note_written(block_id);
+}
+
+static int resolve_fault(int block_id) {
+    map_page_t *page = &dms_ctx->map->pages[block_id];
+    int result;
+
+    switch (page->state) {
+        case MAP_PAGE_NONE:
+            // A store to an inaccessible page faults again once it is readable
+            result = is_owned(block_id) ? map_owned_page(block_id) : fetch_remote_page(block_id);
+            if (result == DMS_SUCCESS) {
+                page->state = MAP_PAGE_READ;
+            }
+            DMS_DEBUG("DEBUG: Process %d mapped block %d on first access\n",
+                      dms_ctx->mpi_rank, block_id);
+            return result;
+        case MAP_PAGE_READ:
+            DMS_DEBUG("DEBUG: Process %d write fault on mapped block %d\n",
+                      dms_ctx->mpi_rank, block_id);
+            return make_writable(block_id);
+        default:
+            // Writable pages do not fault
+            return DMS_ERROR_INVALID_POSITION;
+    }
+}
+
+// Faults outside our range go to whoever handled SIGSEGV before us
+static void chain_fault(int sig, siginfo_t *info, void *context) {
+    if ((previous_action.sa_flags & SA_SIGINFO) && previous_action.sa_sigaction) {
+        previous_action.sa_sigaction(sig, info, context);
+    } else if (previous_action.sa_handler != SIG_DFL && previous_action.sa_handler != SIG_IGN) {
+        previous_action.sa_handler(sig);
+    } else {
+        // The access is retried and terminates the process as usual
+        signal(SIGSEGV, SIG_DFL);
+    }
+}
+
+static void fault_handler(int sig, siginfo_t *info, void *context) {
+    int saved_errno = errno;
+    dms_map_state_t *map = dms_ctx ? dms_ctx->map : NULL;
+    byte *address = info->si_addr;
+
+    if (map && address >= map->base && address < map->base + map->size) {
+        int block_id = (int)((address - map->base) / dms_ctx->config.t);
+        if (resolve_fault(block_id) == DMS_SUCCESS) {
+            errno = saved_errno;
+            return;
+        }
+        fprintf(stderr, "Process %d: cannot resolve access to mapped block %d\n",
+                dms_ctx->mpi_rank, block_id);
+    }
+
+    chain_fault(sig, info, context);
+    errno = saved_errno;
+}
+
+// Installed once per process; contexts of other threads share it
+static void install_handler(void) {
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = fault_handler;
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    handler_result = sigaction(SIGSEGV, &action, &previous_action);
+}
+
+int dms_map(byte **base) {
+    if (!dms_ctx || !base) {
+        return DMS_ERROR_INVALID_POSITION;
+    }
+    if (!dms_ctx->config.map) {
+        return DMS_ERROR_INVALID_PROCESS;
+    }
+    if (dms_ctx->map) {
+        *base = dms_ctx->map->base;
+        return DMS_SUCCESS;
+    }
+
+    pthread_once(&handler_once, install_handler);
+    if (handler_result != 0) {
+        return DMS_ERROR_MEMORY;
+    }
+
+    dms_map_state_t *map = calloc(1, sizeof(dms_map_state_t));
+    if (!map) {
+        return DMS_ERROR_MEMORY;
+    }
+    map->size = (size_t)dms_ctx->config.k * dms_ctx->config.t;
+    map->pages = calloc(dms_ctx->config.k, sizeof(map_page_t));
+    map->base = mmap(NULL, map->size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (!map->pages || map->base == MAP_FAILED) {
+        if (map->base != MAP_FAILED) {
+            munmap(map->base, map->size);
+        }
+        free(map->pages);
+        free(map);
+        return DMS_ERROR_MEMORY;
+    }
+
+    dms_ctx->map = map;
+    *base = map->base;
+    return DMS_SUCCESS;
+}
+
+void map_cleanup(void) {
+    if (!dms_ctx || !dms_ctx->map) return;
+
+    dms_map_state_t *map = dms_ctx->map;
+    for (int i = 0; i < map->num_resident; i++) {
+        free(map->pages[map->resident[i]].twin);
+    }
+    munmap(map->base, map->size);
+    free(map->resident);
+    free(map->pages);
+    free(map);
+    dms_ctx->map = NULL;
+}
+
+// Write notices only concern remote pages: owned pages are the storage the
+// diffs are applied to
+void map_notice(int block_id) {
+    dms_map_state_t *map = dms_ctx->map;
+    if (!map || block_id < 0 || block_id >= dms_ctx->config.k) {
+        return;
+    }
+    if (map->pages[block_id].state != MAP_PAGE_NONE && !is_owned(block_id)) {
+        map->pages[block_id].noticed = 1;
+    }
+}
+
+void map_notice_all(void) {
+    dms_map_state_t *map = dms_ctx->map;
+    if (!map) {
+        return;
+    }
+    for (int i = 0; i < map->num_resident; i++) {
+        map->pages[map->resident[i]].noticed = 1;
+    }
+}
+
+int map_drop_noticed(void) {
+    dms_map_state_t *map = dms_ctx->map;
+    if (!map) {
+        return DMS_SUCCESS;
+    }
+
+    int t = dms_ctx->config.t;
+    int i = 0;
+    while (i < map->num_resident) {
+        int block_id = map->resident[i];
+        map_page_t *page = &map->pages[block_id];
+        if (!page->noticed) {
+            i++;
+            continue;
+        }
+
+        // Our own unreleased stores are merged at the owner first
+        if (page->state == MAP_PAGE_WRITE) {
+            int messages = 0;
+            int result = rc_send_diff(block_id, page_address(block_id), page->twin, &messages);
+            if (result == DMS_SUCCESS) {
+                result = rc_wait_diff_acks(block_id, messages);
+            }
+            if (result != DMS_SUCCESS) {
+                return result;
+            }
+            free(page->twin);
+            page->twin = NULL;
+        }
+
+        mprotect(page_address(block_id), t, PROT_NONE);
+        page->state = MAP_PAGE_NONE;
+        page->noticed = 0;
+        map->resident[i] = map->resident[--map->num_resident];
+    }
+    return DMS_SUCCESS;
+}
+
+int map_drop_remote(void) {
+    map_notice_all();
+    return map_drop_noticed();
+}
+
+// Release side: diffs of the written remote pages, then every written page
+// turns read-only so that the next store is noticed again
+int map_flush_diffs(void) {
+    dms_map_state_t *map = dms_ctx->map;
+    int count = dms_ctx->num_written_blocks;
+    if (!map || count == 0) {
+        return DMS_SUCCESS;
+    }
+
+    int *messages = calloc(count, sizeof(int));
+    if (!messages) {
+        return DMS_ERROR_MEMORY;
+    }
+
+    int result = DMS_SUCCESS;
+    for (int i = 0; i < count && result == DMS_SUCCESS; i++) {
+        int block_id = dms_ctx->written_blocks[i];
+        map_page_t *page = &map->pages[block_id];
+        if (page->state == MAP_PAGE_WRITE && page->twin) {
+            result = rc_send_diff(block_id, page_address(block_id), page->twin, &messages[i]);
+        }
+    }
+
+    for (int i = 0; i < count && result == DMS_SUCCESS; i++) {
+        int block_id = dms_ctx->written_blocks[i];
+        map_page_t *page = &map->pages[block_id];
+        if (page->state != MAP_PAGE_WRITE) {
+            continue;
+        }
+        if (page->twin) {
+            result = rc_wait_diff_acks(block_id, messages[i]);
+            free(page->twin);
+            page->twin = NULL;
+        }
+        mprotect(page_address(block_id), dms_ctx->config.t, PROT_READ);
+        page->state = MAP_PAGE_READ;
+    }
+
+    free(messages);
+    return result;
+}
@@ -0,0 +1,210 @@
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dms.h"
+
+static int range_to_blocks(int posicao, int tamanho, int *first_block, int *last_block) {
+    if (!dms_ctx || posicao < 0 || tamanho <= 0) {
+        return DMS_ERROR_INVALID_POSITION;
+    }
+
+    int64_t total_memory_size = (int64_t)dms_ctx->config.k * dms_ctx->config.t;
+    if ((int64_t)posicao + tamanho > total_memory_size) {
+        return DMS_ERROR_INVALID_SIZE;
+    }
+
+    *first_block = get_block_from_position(posicao);
+    *last_block = get_block_from_position(posicao + tamanho - 1);
+    return DMS_SUCCESS;
+}
+
+// Read-only regions are tracked with block granularity: marking any byte of a
+// block makes the whole block immutable. Every process must mark the same
+// regions, in the same order, before calling dms_replicate().
+int dms_mark_readonly(int posicao, int tamanho) {
+    int first_block, last_block;
+    int result = range_to_blocks(posicao, tamanho, &first_block, &last_block);
+    if (result != DMS_SUCCESS) {
+        return result;
+    }
+
+    if (dms_ctx->num_readonly_regions >= MAX_READONLY_REGIONS) {
+        return DMS_ERROR_MEMORY;
+    }
+
+    for (int i = 0; i < dms_ctx->num_readonly_regions; i++) {
+        readonly_region_t *region = &dms_ctx->readonly_regions[i];
+        if (first_block <= region->last_block && last_block >= region->first_block) {
+            return DMS_ERROR_INVALID_POSITION;
+        }
+    }
+
+    readonly_region_t *region = &dms_ctx->readonly_regions[dms_ctx->num_readonly_regions++];
+    region->first_block = first_block;
+    region->last_block = last_block;
+    region->replicated = 0;
+    region->data = NULL;
+
+    DMS_DEBUG("DEBUG: Process %d marked blocks %d-%d as read-only\n",
+              dms_ctx->mpi_rank, first_block, last_block);
+
+    return DMS_SUCCESS;
+}
+
+int dms_unmark_readonly(int posicao, int tamanho) {
+    int first_block, last_block;
+    int result = range_to_blocks(posicao, tamanho, &first_block, &last_block);
+    if (result != DMS_SUCCESS) {
+        return result;
+    }
+
+    for (int i = 0; i < dms_ctx->num_readonly_regions; i++) {
+        readonly_region_t *region = &dms_ctx->readonly_regions[i];
+        if (region->first_block == first_block && region->last_block == last_block) {
+            free(region->data);
+            dms_ctx->readonly_regions[i] = dms_ctx->readonly_regions[--dms_ctx->num_readonly_regions];
+            return DMS_SUCCESS;
+        }
+    }
+
+    return DMS_ERROR_INVALID_POSITION;
+}
+
+static int replicate_region(readonly_region_t *region) {
+    int n = dms_ctx->config.n;
+    int t = dms_ctx->config.t;
+    int num_blocks = region->last_block - region->first_block + 1;
+
+    int *counts = malloc(n * sizeof(int));
+    int *displs = malloc(n * sizeof(int));
+    int *first_owned = malloc(n * sizeof(int));
+    byte *staging = malloc((size_t)num_blocks * t);
+    region->data = malloc((size_t)num_blocks * t);
+    if (!counts || !displs || !first_owned || !staging || !region->data) {
+        free(counts);
+        free(displs);
+        free(first_owned);
+        free(staging);
+        free(region->data);
+        region->data = NULL;
+        return DMS_ERROR_MEMORY;
+    }
+
+    // With round-robin ownership the blocks a process owns inside the region
+    // are consecutive in its local storage, so each process contributes one
+    // contiguous slice and no packing is needed on the send side.
+    int offset = 0;
+    for (int r = 0; r < n; r++) {
+        first_owned[r] = region->first_block + ((r - region->first_block % n) + n) % n;
+        int owned = 0;
+        if (first_owned[r] <= region->last_block) {
+            owned = (region->last_block - first_owned[r]) / n + 1;
+        }
+        counts[r] = owned * t;
+        displs[r] = offset;
+        offset += counts[r];
+    }
+
+    int me = dms_ctx->config.process_id;
+    byte *send_data = counts[me] > 0 ? get_local_block_data(first_owned[me]) : staging;
+
+    pthread_mutex_lock(&dms_ctx->mpi_mutex);
+    int result = MPI_Allgatherv(send_data, counts[me], MPI_BYTE,
+                                staging, counts, displs, MPI_BYTE, MPI_COMM_WORLD);
+    pthread_mutex_unlock(&dms_ctx->mpi_mutex);
+
+    if (result == MPI_SUCCESS) {
+        // Scatter each process' slice back into block order
+        for (int r = 0; r < n; r++) {
+            for (int j = 0; j < counts[r] / t; j++) {
+                int block_id = first_owned[r] + j * n;
+                memcpy(region->data + (size_t)(block_id - region->first_block) * t,
+                       staging + displs[r] + (size_t)j * t, t);
+            }
+        }
+        region->replicated = 1;
+    } else {
+        free(region->data);
+        region->data = NULL;
+    }
+
+    free(counts);
+    free(displs);
+    free(first_owned);
+    free(staging);
+
+    return result == MPI_SUCCESS ? DMS_SUCCESS : DMS_ERROR_COMMUNICATION;
+}
+
+// Collective: every process must call dms_replicate() after marking the same
+// regions. Afterwards reads of those blocks are served from the local replica.
+int dms_replicate(void) {
+    if (!dms_ctx) {
+        return DMS_ERROR_COMMUNICATION;
+    }
+
+    for (int i = 0; i < dms_ctx->num_readonly_regions; i++) {
+        readonly_region_t *region = &dms_ctx->readonly_regions[i];
+        if (region->replicated) {
+            continue;
+        }
+
+        int result = replicate_region(region);
+        if (result != DMS_SUCCESS) {
+            return result;
+        }
+
+        // Replicated blocks never go through the cache again
+        for (int block_id = region->first_block; block_id <= region->last_block; block_id++) {
+            invalidate_cache_entry(block_id);
+        }
+
+        DMS_DEBUG("DEBUG: Process %d replicated blocks %d-%d\n",
+                  dms_ctx->mpi_rank, region->first_block, region->last_block);
+    }
+
+    return DMS_SUCCESS;
+}
+
+byte *get_replica_block_data(int block_id) {
+    if (!dms_ctx) {
+        return NULL;
+    }
+
+    for (int i = 0; i < dms_ctx->num_readonly_regions; i++) {
+        readonly_region_t *region = &dms_ctx->readonly_regions[i];
+        if (region->replicated && block_id >= region->first_block && block_id <= region->last_block) {
+            return region->data + (size_t)(block_id - region->first_block) * dms_ctx->config.t;
+        }
+    }
+    return NULL;
+}
+
+int is_readonly_range(int posicao, int tamanho) {
+    if (!dms_ctx || dms_ctx->num_readonly_regions == 0) {
+        return 0;
+    }
+
+    int first_block = get_block_from_position(posicao);
+    int last_block = get_block_from_position(posicao + tamanho - 1);
+
+    for (int i = 0; i < dms_ctx->num_readonly_regions; i++) {
+        readonly_region_t *region = &dms_ctx->readonly_regions[i];
+        if (first_block <= region->last_block && last_block >= region->first_block) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void free_readonly_regions(void) {
+    if (!dms_ctx) return;
+
+    for (int i = 0; i < dms_ctx->num_readonly_regions; i++) {
+        free(dms_ctx->readonly_regions[i].data);
+        dms_ctx->readonly_regions[i].data = NULL;
+    }
+    dms_ctx->num_readonly_regions = 0;
+}
@@ -0,0 +1,246 @@
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dms.h"
+
+// One-sided transport. Every process exposes three windows:
+//   - rma_data_win:  its owned blocks (dms_ctx->blocks)
+//   - rma_dir_win:   one sharer vector (dms_sharer_bit()) per owned block
+//   - rma_inval_win: "stale" flags, one per block_id % RMA_STALE_SLOTS
+// Readers register in the owner's directory before fetching a block; writers
+// update the data, atomically take the sharer vector and raise the stale flag
+// of every registered reader. No owner CPU involvement is needed. A reader
+// caches at most one block per stale slot, so the flags cost a fixed amount
+// of memory whatever k; a flag raised for another block of the slot only
+// causes an extra fetch.
+
+#define RMA_STALE_SLOTS 16384
+
+static inline MPI_Aint rma_block_disp(int block_id) {
+    // Round-robin distribution: block i is the (i / n)-th local block of its owner
+    return (MPI_Aint)(block_id / dms_ctx->config.n);
+}
+
+static inline int rma_stale_slot(int block_id) {
+    return block_id % dms_ctx->rma_inval_slots;
+}
+
+int rma_init(int local_blocks) {
+    if (!dms_ctx) {
+        return DMS_ERROR_COMMUNICATION;
+    }
+
+    dms_ctx->rma_inval_slots = dms_ctx->config.k < RMA_STALE_SLOTS ? dms_ctx->config.k : RMA_STALE_SLOTS;
+
+    MPI_Aint data_size = (MPI_Aint)local_blocks * dms_ctx->config.t;
+    MPI_Aint dir_size = (MPI_Aint)local_blocks * sizeof(uint64_t);
+    MPI_Aint inval_size = (MPI_Aint)dms_ctx->rma_inval_slots;
+
+    // MPI_Win_allocate (rather than MPI_Win_create over malloc'ed memory) lets
+    // Open MPI use its shared-memory component on a single node even when the
+    // vader BTL is disabled, as in docker/docker-compose.yml.
+    if (MPI_Win_allocate(data_size, 1, MPI_INFO_NULL, MPI_COMM_WORLD,
+                         &dms_ctx->blocks, &dms_ctx->rma_data_win) != MPI_SUCCESS) {
+        return DMS_ERROR_MEMORY;
+    }
+    if (MPI_Win_allocate(dir_size, sizeof(uint64_t), MPI_INFO_NULL, MPI_COMM_WORLD,
+                         &dms_ctx->rma_sharers, &dms_ctx->rma_dir_win) != MPI_SUCCESS) {
+        MPI_Win_free(&dms_ctx->rma_data_win);
+        dms_ctx->blocks = NULL;
+        return DMS_ERROR_MEMORY;
+    }
+    if (MPI_Win_allocate(inval_size, 1, MPI_INFO_NULL, MPI_COMM_WORLD,
+                         &dms_ctx->rma_inval, &dms_ctx->rma_inval_win) != MPI_SUCCESS) {
+        MPI_Win_free(&dms_ctx->rma_dir_win);
+        MPI_Win_free(&dms_ctx->rma_data_win);
+        dms_ctx->blocks = NULL;
+        return DMS_ERROR_MEMORY;
+    }
+
+    // Stale flags are read with plain loads, which requires the unified model
+    int *model;
+    int flag;
+    MPI_Win_get_attr(dms_ctx->rma_inval_win, MPI_WIN_MODEL, &model, &flag);
+    if (!flag || *model != MPI_WIN_UNIFIED) {
+        MPI_Win_free(&dms_ctx->rma_inval_win);
+        MPI_Win_free(&dms_ctx->rma_dir_win);
+        MPI_Win_free(&dms_ctx->rma_data_win);
+        dms_ctx->blocks = NULL;
+        return DMS_ERROR_COMMUNICATION;
+    }
+
+    memset(dms_ctx->blocks, 0, data_size);
+    memset(dms_ctx->rma_sharers, 0, dir_size);
+    memset(dms_ctx->rma_inval, 0, inval_size);
+
+    // Nobody may touch a remote window before it has been zeroed
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    // A single passive-target epoch spans the whole lifetime of the windows;
+    // individual operations are completed with MPI_Win_flush.
+    MPI_Win_lock_all(0, dms_ctx->rma_data_win);
+    MPI_Win_lock_all(0, dms_ctx->rma_dir_win);
+    MPI_Win_lock_all(0, dms_ctx->rma_inval_win);
+
+    return DMS_SUCCESS;
+}
+
+void rma_cleanup(void) {
+    if (!dms_ctx || !dms_ctx->blocks) return;
+
+    MPI_Win_unlock_all(dms_ctx->rma_inval_win);
+    MPI_Win_unlock_all(dms_ctx->rma_dir_win);
+    MPI_Win_unlock_all(dms_ctx->rma_data_win);
+
+    MPI_Win_free(&dms_ctx->rma_inval_win);
+    MPI_Win_free(&dms_ctx->rma_dir_win);
+    MPI_Win_free(&dms_ctx->rma_data_win);
+
+    dms_ctx->blocks = NULL;
+    dms_ctx->rma_sharers = NULL;
+    dms_ctx->rma_inval = NULL;
+}
+
+int rma_fetch_block(int block_id, int owner_pid) {
+    if (!dms_ctx || block_id < 0 || block_id >= dms_ctx->config.k) {
+        return DMS_ERROR_INVALID_POSITION;
+    }
+
+    int me = dms_ctx->config.process_id;
+    byte clear = 0;
+    uint64_t bit = dms_sharer_bit(me);
+    uint64_t previous;
+    int slot = rma_stale_slot(block_id);
+
+    cache_entry_t *cache_entry = allocate_cache_entry(block_id);
+    if (!cache_entry) {
+        return DMS_ERROR_MEMORY;
+    }
+
+    // Clearing the slot below would hide writes to the block cached in it
+    for (int i = 0; i < CACHE_SIZE; i++) {
+        cache_entry_t *other = &dms_ctx->cache[i];
+        if (other != cache_entry && other->valid && rma_stale_slot(other->block_id) == slot) {
+            invalidate_cache_entry(other->block_id);
+        }
+    }
+
+    pthread_mutex_lock(&dms_ctx->mpi_mutex);
+
+    // 1. Clear our stale flag, 2. register as sharer, 3. fetch the data.
+    // A writer that takes the sharer mask after step 2 raises the flag again;
+    // one that took it before step 2 has already completed its update.
+    MPI_Accumulate(&clear, 1, MPI_BYTE, me, slot, 1, MPI_BYTE,
+                   MPI_REPLACE, dms_ctx->rma_inval_win);
+    MPI_Win_flush(me, dms_ctx->rma_inval_win);
+
+    MPI_Fetch_and_op(&bit, &previous, MPI_UINT64_T, owner_pid, rma_block_disp(block_id),
+                     MPI_BOR, dms_ctx->rma_dir_win);
+    MPI_Win_flush(owner_pid, dms_ctx->rma_dir_win);
+
+    pthread_mutex_lock(&cache_entry->mutex);
+    int result = MPI_Get_accumulate(NULL, 0, MPI_BYTE,
+                                    cache_entry->data, dms_ctx->config.t, MPI_BYTE,
+                                    owner_pid, rma_block_disp(block_id) * dms_ctx->config.t,
+                                    dms_ctx->config.t, MPI_BYTE, MPI_NO_OP, dms_ctx->rma_data_win);
+    MPI_Win_flush(owner_pid, dms_ctx->rma_data_win);
+    cache_entry->valid = (result == MPI_SUCCESS);
+    cache_entry->sectors = get_sector_mask(0, dms_ctx->config.t);
+    pthread_mutex_unlock(&cache_entry->mutex);
+
+    pthread_mutex_unlock(&dms_ctx->mpi_mutex);
+
+    return result == MPI_SUCCESS ? DMS_SUCCESS : DMS_ERROR_COMMUNICATION;
+}
+
+int rma_block_is_stale(int block_id) {
+    if (!dms_ctx || !dms_ctx->rma_inval) {
+        return 0;
+    }
+
+    MPI_Win_sync(dms_ctx->rma_inval_win);
+    return ((volatile byte *)dms_ctx->rma_inval)[rma_stale_slot(block_id)] != 0;
+}
+
+// Takes the owner's sharer vector and raises the stale flag of every other
+// process it covers. Called with mpi_mutex held.
+static void invalidate_sharers(int block_id, int owner_pid) {
+    int me = dms_ctx->config.process_id;
+    int n = dms_ctx->config.n;
+    int group = dms_ctx->sharer_group;
+    uint64_t none = 0;
+    uint64_t sharers;
+    byte stale = 1;
+
+    MPI_Fetch_and_op(&none, &sharers, MPI_UINT64_T, owner_pid, rma_block_disp(block_id),
+                     MPI_REPLACE, dms_ctx->rma_dir_win);
+    MPI_Win_flush(owner_pid, dms_ctx->rma_dir_win);
+
+    while (sharers) {
+        int bit = __builtin_ctzll(sharers);
+        sharers &= sharers - 1;
+        int last = (bit + 1) * group < n ? (bit + 1) * group : n;
+        for (int i = bit * group; i < last; i++) {
+            if (i != me) {
+                MPI_Accumulate(&stale, 1, MPI_BYTE, i, rma_stale_slot(block_id), 1, MPI_BYTE,
+                               MPI_REPLACE, dms_ctx->rma_inval_win);
+            }
+        }
+    }
+    MPI_Win_flush_all(dms_ctx->rma_inval_win);
+}
+
+int rma_write_block(int block_id, int owner_pid, int offset, const byte *data, int size) {
+    if (!dms_ctx || block_id < 0 || block_id >= dms_ctx->config.k) {
+        return DMS_ERROR_INVALID_POSITION;
+    }
+
+    pthread_mutex_lock(&dms_ctx->mpi_mutex);
+
+    // MPI_REPLACE accumulates are atomic with respect to the readers'
+    // MPI_Get_accumulate, unlike plain MPI_Put/MPI_Get pairs.
+    int result = MPI_Accumulate(data, size, MPI_BYTE,
+                                owner_pid, rma_block_disp(block_id) * dms_ctx->config.t + offset,
+                                size, MPI_BYTE, MPI_REPLACE, dms_ctx->rma_data_win);
+    MPI_Win_flush(owner_pid, dms_ctx->rma_data_win);
+
+    if (result == MPI_SUCCESS) {
+        invalidate_sharers(block_id, owner_pid);
+    }
+
+    pthread_mutex_unlock(&dms_ctx->mpi_mutex);
+
+    // Our own copy is refreshed on the next read
+    invalidate_cache_entry(block_id);
+
+    return result == MPI_SUCCESS ? DMS_SUCCESS : DMS_ERROR_COMMUNICATION;
+}
+
+// Atomics are executed by the owner on its own window memory, like with the
+// message transport: the MPI library's MPI_Compare_and_swap is not usable on
+// every Open MPI configuration (osc/rdma over vader/ofi crashes), and owner
+// execution serializes all atomics on a block. Sharers are then invalidated
+// through the directory exactly like after rma_write_block().
+int rma_atomic_block(message_type_t op, int block_id, int offset,
+                     const dms_atomic_args_t *args, dms_atomic_result_t *result) {
+    byte *local_data = get_local_block_data(block_id);
+    if (!local_data) {
+        return DMS_ERROR_BLOCK_NOT_FOUND;
+    }
+
+    pthread_mutex_lock(&dms_ctx->mpi_mutex);
+
+    MPI_Win_sync(dms_ctx->rma_data_win);
+    int status = atomic_apply(op, local_data + offset, args, result);
+    MPI_Win_sync(dms_ctx->rma_data_win);
+
+    if (status == DMS_SUCCESS && result->changed) {
+        invalidate_sharers(block_id, dms_ctx->config.process_id);
+    }
+
+    pthread_mutex_unlock(&dms_ctx->mpi_mutex);
+
+    return status;
+}
@@ -0,0 +1,170 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dms.h"
+
+// Sharer directory and invalidation fan-out. The owner of a block remembers
+// which processes fetched it since its last whole-block invalidation, as a
+// SHARER_BITS-bit vector per owned block in which every bit covers
+// ceil(n / SHARER_BITS) consecutive processes. Up to 64 processes the vector
+// is exact; beyond that a bit may stand for a few processes that never read
+// the block, which only costs spurious invalidations. The directory takes 8
+// bytes per owned block whatever n, and a write invalidates the processes of
+// the set bits instead of all n - 1 others.
+//
+// Invalidations to more than DMS_INVALIDATE_FANOUT processes travel down a
+// tree: the sender splits the targets into DMS_INVALIDATE_FANOUT contiguous
+// groups and sends one MSG_INVALIDATE to the first process of each, with the
+// rest of the group appended as int16 ids; that process invalidates its copy,
+// forwards to its group the same way and acknowledges once its subtree has.
+// Every sender waits for at most DMS_INVALIDATE_FANOUT acks, and the depth
+// grows with log(n).
+
+typedef uint16_t relay_id_t;
+
+int sharers_init(int local_blocks) {
+    dms_ctx->sharer_group = (dms_ctx->config.n + SHARER_BITS - 1) / SHARER_BITS;
+
+    // The RMA transport keeps its directory in a window (dms_rma.c)
+    if (dms_ctx->config.transport == DMS_TRANSPORT_RMA || local_blocks == 0) {
+        return DMS_SUCCESS;
+    }
+
+    dms_ctx->sharers = calloc(local_blocks, sizeof(uint64_t));
+    return dms_ctx->sharers ? DMS_SUCCESS : DMS_ERROR_MEMORY;
+}
+
+void sharers_cleanup(void) {
+    if (!dms_ctx) return;
+
+    free(dms_ctx->sharers);
+    dms_ctx->sharers = NULL;
+}
+
+static uint64_t *sharers_of(int block_id) {
+    size_t index = dms_ctx->n_shift >= 0 ? (size_t)(block_id >> dms_ctx->n_shift)
+                                         : (size_t)(block_id / dms_ctx->config.n);
+    return &dms_ctx->sharers[index];
+}
+
+// Owner side of MSG_READ_REQUEST: the requester may cache the block from now on
+void sharers_note_reader(int block_id, int pid) {
+    if (dms_ctx->sharers && get_block_owner(block_id) == dms_ctx->config.process_id) {
+        *sharers_of(block_id) |= dms_sharer_bit(pid);
+    }
+}
+
+// Processes to invalidate: those behind the set bits of the vector, except
+// ourselves, the writer (which dropped its own sectors) and node-local
+// processes (which read the block directly and never cache it)
+static int collect_targets(uint64_t vector, int requester_pid, relay_id_t *targets) {
+    int n = dms_ctx->config.n;
+    int group = dms_ctx->sharer_group;
+    int count = 0;
+
+    while (vector) {
+        int bit = __builtin_ctzll(vector);
+        vector &= vector - 1;
+        int last = (bit + 1) * group < n ? (bit + 1) * group : n;
+        for (int pid = bit * group; pid < last; pid++) {
+            if (pid != dms_ctx->mpi_rank && pid != requester_pid && !shm_is_node_local(pid)) {
+                targets[count++] = (relay_id_t)pid;
+            }
+        }
+    }
+    return count;
+}
+
+// Sends the invalidation of [offset, offset + size) of block_id to the
+// targets, one message per group of the tree, and waits for the group
+// leaders' acks
+static int fan_out(int block_id, int offset, int size, const relay_id_t *targets, int count) {
+    int groups = count < DMS_INVALIDATE_FANOUT ? count : DMS_INVALIDATE_FANOUT;
+    int expected_acks = 0;
+
+    for (int g = 0; g < groups; g++) {
+        int first = (int)((int64_t)count * g / groups);
+        int end = (int)((int64_t)count * (g + 1) / groups);
+
+        dms_message_t invalidate_msg;
+        memset(&invalidate_msg, 0, offsetof(dms_message_t, data));
+        invalidate_msg.type = MSG_INVALIDATE;
+        invalidate_msg.block_id = block_id;
+        invalidate_msg.position = offset;
+        int32_t length = size;
+        memcpy(invalidate_msg.data, &length, sizeof(length));
+        int relays = end - first - 1;
+        memcpy(invalidate_msg.data + sizeof(length), targets + first + 1, relays * sizeof(relay_id_t));
+        invalidate_msg.size = (int)(sizeof(length) + relays * sizeof(relay_id_t));
+
+        if (send_message(targets[first], &invalidate_msg) == DMS_SUCCESS) {
+            expected_acks++;
+            dms_ctx->invalidations_sent++;
+        }
+    }
+
+    // Responses that arrive meanwhile are kept for their waiters
+    int result = DMS_SUCCESS;
+    for (int i = 0; i < expected_acks; i++) {
+        dms_message_t ack;
+        if (wait_for_message(MSG_INVALIDATE_ACK, block_id, &ack) != DMS_SUCCESS) {
+            result = DMS_ERROR_COMMUNICATION;
+            break;
+        }
+    }
+    return result;
+}
+
+// Invalidates the sectors covering [offset, offset + size) of block_id in
+// every other cache that may hold them
+int invalidate_cache_and_wait_acks(int block_id, int offset, int size, int requester_pid) {
+    if (!dms_ctx) {
+        return DMS_ERROR_COMMUNICATION;
+    }
+
+    // Node-local writers (-s) do not see the owner's directory and invalidate everybody
+    int owned = dms_ctx->sharers && get_block_owner(block_id) == dms_ctx->config.process_id;
+    uint64_t vector = owned ? *sharers_of(block_id) : ~(uint64_t)0;
+    if (vector == 0) {
+        return DMS_SUCCESS;
+    }
+
+    relay_id_t targets[MAX_PROCESSES];
+    int count = collect_targets(vector, requester_pid, targets);
+
+    // After a whole-block invalidation nobody caches the block but maybe the
+    // writer, whose unwritten sectors stay valid. The vector is cleared before
+    // waiting, so that reads served meanwhile register again.
+    int whole_block = get_sector_mask(offset, size) == get_sector_mask(0, dms_ctx->config.t);
+    if (owned && whole_block) {
+        *sharers_of(block_id) &= requester_pid != dms_ctx->mpi_rank ? dms_sharer_bit(requester_pid) : 0;
+    }
+
+    int result = fan_out(block_id, offset, size, targets, count);
+    if (owned && whole_block && result != DMS_SUCCESS) {
+        *sharers_of(block_id) |= vector;  // some copies may have survived
+    }
+    return result;
+}
+
+// MSG_INVALIDATE receiver, after dropping its own copy: forwards to the
+// processes listed after the range and waits for them before acknowledging
+int relay_invalidation(const dms_message_t *msg) {
+    int32_t length;
+    int relays = (msg->size - (int)sizeof(length)) / (int)sizeof(relay_id_t);
+    if (relays <= 0) {
+        return DMS_SUCCESS;
+    }
+
+    relay_id_t targets[MAX_PROCESSES];
+    if (relays > MAX_PROCESSES) {
+        return DMS_ERROR_INVALID_PROCESS;
+    }
+    memcpy(&length, msg->data, sizeof(length));
+    memcpy(targets, msg->data + sizeof(length), relays * sizeof(relay_id_t));
+
+    DMS_DEBUG("DEBUG: Process %d relaying the invalidation of block %d to %d processes\n",
+              dms_ctx->mpi_rank, msg->block_id, relays);
+    return fan_out(msg->block_id, msg->position, length, targets, relays);
+}
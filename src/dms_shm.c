@@ -0,0 +1,187 @@
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dms.h"
+
+// Shared-memory fast path. Processes on the same node place their block
+// storage in one MPI_Win_allocate_shared segment, so a block owned by a
+// node-local process is read and written with plain loads and stores.
+// Each block carries a sequence counter used as a seqlock: writers make it
+// odd while updating, readers retry if it was odd or changed under them.
+// Node-local processes never cache each other's blocks, so only off-node
+// caches need to be invalidated after a direct store.
+
+static int count_local_blocks(int pid) {
+    int blocks = dms_ctx->config.k / dms_ctx->config.n;
+    if (pid < dms_ctx->config.k % dms_ctx->config.n) {
+        blocks++;
+    }
+    return blocks;
+}
+
+static size_t seq_offset(int local_blocks) {
+    size_t data_size = (size_t)local_blocks * dms_ctx->config.t;
+    return (data_size + 7) & ~(size_t)7;
+}
+
+int shm_init(int local_blocks) {
+    if (!dms_ctx) {
+        return DMS_ERROR_COMMUNICATION;
+    }
+
+    int n = dms_ctx->config.n;
+    dms_ctx->shm_peer_blocks = calloc(n, sizeof(byte *));
+    dms_ctx->shm_peer_seq = calloc(n, sizeof(uint32_t *));
+    if (!dms_ctx->shm_peer_blocks || !dms_ctx->shm_peer_seq) {
+        free(dms_ctx->shm_peer_blocks);
+        free(dms_ctx->shm_peer_seq);
+        dms_ctx->shm_peer_blocks = NULL;
+        dms_ctx->shm_peer_seq = NULL;
+        return DMS_ERROR_MEMORY;
+    }
+
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &dms_ctx->shm_comm);
+
+    MPI_Aint segment_size = seq_offset(local_blocks) + (size_t)local_blocks * sizeof(uint32_t);
+    byte *base;
+    if (MPI_Win_allocate_shared(segment_size, 1, MPI_INFO_NULL, dms_ctx->shm_comm,
+                                &base, &dms_ctx->shm_win) != MPI_SUCCESS) {
+        MPI_Comm_free(&dms_ctx->shm_comm);
+        free(dms_ctx->shm_peer_blocks);
+        free(dms_ctx->shm_peer_seq);
+        dms_ctx->shm_peer_blocks = NULL;
+        dms_ctx->shm_peer_seq = NULL;
+        return DMS_ERROR_MEMORY;
+    }
+    memset(base, 0, segment_size);
+    dms_ctx->blocks = base;
+
+    // Map every node-local peer's segment into our address space
+    int node_size;
+    MPI_Group world_group, node_group;
+    MPI_Comm_size(dms_ctx->shm_comm, &node_size);
+    MPI_Comm_group(MPI_COMM_WORLD, &world_group);
+    MPI_Comm_group(dms_ctx->shm_comm, &node_group);
+
+    for (int node_rank = 0; node_rank < node_size; node_rank++) {
+        int world_rank;
+        MPI_Group_translate_ranks(node_group, 1, &node_rank, world_group, &world_rank);
+
+        MPI_Aint peer_size;
+        int disp_unit;
+        byte *peer_base;
+        MPI_Win_shared_query(dms_ctx->shm_win, node_rank, &peer_size, &disp_unit, &peer_base);
+
+        dms_ctx->shm_peer_blocks[world_rank] = peer_base;
+        dms_ctx->shm_peer_seq[world_rank] =
+            (uint32_t *)(peer_base + seq_offset(count_local_blocks(world_rank)));
+    }
+
+    MPI_Group_free(&node_group);
+    MPI_Group_free(&world_group);
+
+    // Peers may only access our segment once it has been zeroed
+    MPI_Barrier(dms_ctx->shm_comm);
+
+    DMS_DEBUG("DEBUG: Process %d shares memory with %d node-local processes\n",
+              dms_ctx->mpi_rank, node_size - 1);
+
+    return DMS_SUCCESS;
+}
+
+void shm_cleanup(void) {
+    if (!dms_ctx || !dms_ctx->shm_peer_blocks) return;
+
+    MPI_Win_free(&dms_ctx->shm_win);
+    MPI_Comm_free(&dms_ctx->shm_comm);
+    free(dms_ctx->shm_peer_blocks);
+    free(dms_ctx->shm_peer_seq);
+    dms_ctx->shm_peer_blocks = NULL;
+    dms_ctx->shm_peer_seq = NULL;
+    dms_ctx->blocks = NULL;
+}
+
+int shm_is_node_local(int pid) {
+    return dms_ctx && dms_ctx->shm_peer_blocks && pid >= 0 && pid < dms_ctx->config.n &&
+           dms_ctx->shm_peer_blocks[pid] != NULL;
+}
+
+int shm_read(int block_id, int offset, byte *dest, int size) {
+    int owner = get_block_owner(block_id);
+    if (!shm_is_node_local(owner)) {
+        return DMS_ERROR_BLOCK_NOT_FOUND;
+    }
+
+    int local_index = block_id / dms_ctx->config.n;
+    byte *data = dms_ctx->shm_peer_blocks[owner] + (size_t)local_index * dms_ctx->config.t;
+    uint32_t *seq = &dms_ctx->shm_peer_seq[owner][local_index];
+
+    uint32_t before, after;
+    do {
+        before = __atomic_load_n(seq, __ATOMIC_ACQUIRE);
+        if (before & 1) {
+            continue;  // writer in progress
+        }
+        memcpy(dest, data + offset, size);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        after = __atomic_load_n(seq, __ATOMIC_RELAXED);
+    } while ((before & 1) || before != after);
+
+    return DMS_SUCCESS;
+}
+
+// Taking the counter from even to odd also serializes concurrent writers
+static uint32_t seq_write_begin(uint32_t *seq) {
+    uint32_t current = __atomic_load_n(seq, __ATOMIC_RELAXED);
+    for (;;) {
+        if (!(current & 1) &&
+            __atomic_compare_exchange_n(seq, &current, current + 1, 0,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            return current;
+        }
+        current = __atomic_load_n(seq, __ATOMIC_RELAXED);
+    }
+}
+
+static void seq_write_end(uint32_t *seq, uint32_t begin) {
+    __atomic_store_n(seq, begin + 2, __ATOMIC_RELEASE);
+}
+
+int shm_write(int block_id, int offset, const byte *src, int size) {
+    int owner = get_block_owner(block_id);
+    if (!shm_is_node_local(owner)) {
+        return DMS_ERROR_BLOCK_NOT_FOUND;
+    }
+
+    int local_index = block_id / dms_ctx->config.n;
+    byte *data = dms_ctx->shm_peer_blocks[owner] + (size_t)local_index * dms_ctx->config.t;
+    uint32_t *seq = &dms_ctx->shm_peer_seq[owner][local_index];
+
+    uint32_t begin = seq_write_begin(seq);
+    memcpy(data + offset, src, size);
+    seq_write_end(seq, begin);
+
+    return DMS_SUCCESS;
+}
+
+// The write side of the seqlock makes the read-modify-write exclusive among
+// every node-local process, including the owner serving remote requests
+int shm_atomic(message_type_t op, int block_id, int offset,
+               const dms_atomic_args_t *args, dms_atomic_result_t *result) {
+    int owner = get_block_owner(block_id);
+    if (!shm_is_node_local(owner)) {
+        return DMS_ERROR_BLOCK_NOT_FOUND;
+    }
+
+    int local_index = block_id / dms_ctx->config.n;
+    byte *data = dms_ctx->shm_peer_blocks[owner] + (size_t)local_index * dms_ctx->config.t;
+    uint32_t *seq = &dms_ctx->shm_peer_seq[owner][local_index];
+
+    uint32_t begin = seq_write_begin(seq);
+    int status = atomic_apply(op, data + offset, args, result);
+    seq_write_end(seq, begin);
+
+    return status;
+}
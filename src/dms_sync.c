@@ -0,0 +1,356 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dms.h"
+
+// Locks and barriers. Lock 'id' is managed by its home process, id % n,
+// which keeps the holder and a FIFO of waiting processes: dms_lock() sends
+// one MSG_LOCK_REQUEST and blocks until the home hands the lock over with
+// MSG_LOCK_GRANT, so waiters never retry. dms_barrier() is centralized at
+// process 0, which answers every MSG_BARRIER_ENTER of an epoch with one
+// MSG_BARRIER_RELEASE once all n processes arrived.
+//
+// Under release consistency the synchronization messages also carry the
+// coherence work: dms_unlock() and dms_barrier() write their diffs back and
+// put their write notices on MSG_UNLOCK / MSG_BARRIER_ENTER; the home keeps
+// a log of the notices of each lock and sends every new holder those it has
+// not seen yet on its grant, and process 0 sends the union on the barrier
+// release. Processes that never synchronize on a lock are not disturbed.
+
+typedef struct lock_state {
+    struct lock_state *next;
+    int id;
+    int holder;                  // -1 when free
+    int *waiters;                // FIFO ring of requesting processes, n entries
+    int first_waiter;
+    int num_waiters;
+    // Release consistency: ring of the last NOTICES_PER_MESSAGE block ids
+    // written under the lock, numbered [log_start, log_end)
+    int32_t *log;
+    long log_start;
+    long log_end;
+    long *seen;                  // per process, log_end at its last grant
+} lock_state_t;
+
+struct dms_sync_state {
+    lock_state_t *locks[LOCK_TABLE_SIZE];
+    int barrier_epoch;    // barriers this process has passed
+    int barrier_arrived;  // process 0: processes in the current barrier
+    int32_t *barrier_notices;
+    int barrier_num_notices;
+    int barrier_overflow;
+};
+
+int sync_init(void) {
+    dms_ctx->sync = calloc(1, sizeof(dms_sync_state_t));
+    if (!dms_ctx->sync) {
+        return DMS_ERROR_MEMORY;
+    }
+
+    if (dms_ctx->config.coherence == DMS_COHERENCE_RELEASE && dms_ctx->config.process_id == 0) {
+        dms_ctx->sync->barrier_notices = malloc(NOTICES_PER_MESSAGE * sizeof(int32_t));
+        if (!dms_ctx->sync->barrier_notices) {
+            sync_cleanup();
+            return DMS_ERROR_MEMORY;
+        }
+    }
+    return DMS_SUCCESS;
+}
+
+void sync_cleanup(void) {
+    if (!dms_ctx || !dms_ctx->sync) return;
+
+    for (int i = 0; i < LOCK_TABLE_SIZE; i++) {
+        lock_state_t *lock = dms_ctx->sync->locks[i];
+        while (lock) {
+            lock_state_t *next = lock->next;
+            free(lock->waiters);
+            free(lock->seen);
+            free(lock->log);
+            free(lock);
+            lock = next;
+        }
+    }
+    free(dms_ctx->sync->barrier_notices);
+    free(dms_ctx->sync);
+    dms_ctx->sync = NULL;
+}
+
+static int lock_home(int id) {
+    return id % dms_ctx->config.n;
+}
+
+static lock_state_t *get_lock_state(int id) {
+    lock_state_t **bucket = &dms_ctx->sync->locks[(id / dms_ctx->config.n) % LOCK_TABLE_SIZE];
+    for (lock_state_t *lock = *bucket; lock; lock = lock->next) {
+        if (lock->id == id) {
+            return lock;
+        }
+    }
+
+    lock_state_t *lock = calloc(1, sizeof(lock_state_t));
+    if (!lock) {
+        return NULL;
+    }
+    // Sized by n rather than MAX_PROCESSES: a home may keep many locks
+    lock->waiters = malloc(dms_ctx->config.n * sizeof(int));
+    if (!lock->waiters) {
+        free(lock);
+        return NULL;
+    }
+    if (dms_ctx->config.coherence == DMS_COHERENCE_RELEASE) {
+        lock->log = malloc(NOTICES_PER_MESSAGE * sizeof(int32_t));
+        lock->seen = calloc(dms_ctx->config.n, sizeof(long));
+        if (!lock->log || !lock->seen) {
+            free(lock->log);
+            free(lock->seen);
+            free(lock->waiters);
+            free(lock);
+            return NULL;
+        }
+    }
+    lock->id = id;
+    lock->holder = -1;
+    lock->next = *bucket;
+    *bucket = lock;
+    return lock;
+}
+
+// Appends the notices of an MSG_UNLOCK to the lock's log
+static void log_notices(lock_state_t *lock, const dms_message_t *msg) {
+    if (!lock->log) {
+        return;
+    }
+
+    if (msg->position) {
+        // Too many to list: every other process must drop its whole cache
+        lock->log_end += NOTICES_PER_MESSAGE;
+        lock->log_start = lock->log_end;
+        return;
+    }
+
+    int count = msg->size / (int)sizeof(int32_t);
+    for (int i = 0; i < count; i++) {
+        memcpy(&lock->log[lock->log_end % NOTICES_PER_MESSAGE],
+               msg->data + i * sizeof(int32_t), sizeof(int32_t));
+        lock->log_end++;
+    }
+    if (lock->log_end - lock->log_start > NOTICES_PER_MESSAGE) {
+        lock->log_start = lock->log_end - NOTICES_PER_MESSAGE;
+    }
+}
+
+static int send_grant(lock_state_t *lock, int pid) {
+    dms_message_t grant;
+    memset(&grant, 0, offsetof(dms_message_t, data));
+    grant.type = MSG_LOCK_GRANT;
+    grant.block_id = lock->id;
+    grant.size = 0;
+
+    if (lock->log) {
+        // The notices logged since the process last held the lock
+        if (lock->seen[pid] < lock->log_start) {
+            grant.position = 1;
+        } else {
+            int count = 0;
+            for (long i = lock->seen[pid]; i < lock->log_end; i++) {
+                memcpy(grant.data + count * sizeof(int32_t),
+                       &lock->log[i % NOTICES_PER_MESSAGE], sizeof(int32_t));
+                count++;
+            }
+            grant.size = count * (int)sizeof(int32_t);
+        }
+        lock->seen[pid] = lock->log_end;
+    }
+
+    lock->holder = pid;
+    return send_message(pid, &grant);
+}
+
+// Home side of MSG_LOCK_REQUEST: grant at once or queue the requester
+int handle_lock_request(dms_message_t *msg) {
+    lock_state_t *lock = get_lock_state(msg->block_id);
+    if (!lock) {
+        return DMS_ERROR_MEMORY;
+    }
+
+    if (lock->holder < 0) {
+        return send_grant(lock, msg->source_pid);
+    }
+
+    if (lock->num_waiters == dms_ctx->config.n) {
+        return DMS_ERROR_INVALID_PROCESS;
+    }
+    lock->waiters[(lock->first_waiter + lock->num_waiters) % dms_ctx->config.n] = msg->source_pid;
+    lock->num_waiters++;
+    return DMS_SUCCESS;
+}
+
+// Home side of MSG_UNLOCK: hand the lock to the oldest waiter
+int handle_unlock(dms_message_t *msg) {
+    lock_state_t *lock = get_lock_state(msg->block_id);
+    if (!lock) {
+        return DMS_ERROR_MEMORY;
+    }
+    if (lock->holder != msg->source_pid) {
+        DMS_DEBUG("DEBUG: Process %d ignoring unlock of lock %d by non-holder %d\n",
+                  dms_ctx->mpi_rank, lock->id, msg->source_pid);
+        return DMS_ERROR_INVALID_PROCESS;
+    }
+
+    log_notices(lock, msg);
+
+    if (lock->num_waiters == 0) {
+        lock->holder = -1;
+        return DMS_SUCCESS;
+    }
+
+    int next = lock->waiters[lock->first_waiter];
+    lock->first_waiter = (lock->first_waiter + 1) % dms_ctx->config.n;
+    lock->num_waiters--;
+    return send_grant(lock, next);
+}
+
+int dms_lock(int id) {
+    if (!dms_ctx) {
+        return DMS_ERROR_COMMUNICATION;
+    }
+    if (id < 0) {
+        return DMS_ERROR_INVALID_POSITION;
+    }
+
+    dms_message_t request;
+    memset(&request, 0, offsetof(dms_message_t, data));
+    request.type = MSG_LOCK_REQUEST;
+    request.block_id = id;
+    request.size = 0;
+
+    // Also when we are the home: the grant then comes back through our own queue
+    int result = send_message(lock_home(id), &request);
+    if (result != DMS_SUCCESS) {
+        return result;
+    }
+
+    // A lock may be held for any time, so there is no timeout
+    dms_message_t grant;
+    result = wait_for_message_timeout(MSG_LOCK_GRANT, id, &grant, -1);
+    if (result != DMS_SUCCESS) {
+        return result;
+    }
+
+    DMS_DEBUG("DEBUG: Process %d acquired lock %d with %d write notices\n",
+              dms_ctx->mpi_rank, id, grant.size / (int)sizeof(int32_t));
+
+    return rc_apply_notices(&grant);
+}
+
+int dms_unlock(int id) {
+    if (!dms_ctx) {
+        return DMS_ERROR_COMMUNICATION;
+    }
+    if (id < 0) {
+        return DMS_ERROR_INVALID_POSITION;
+    }
+
+    // Owners must hold our writes before the next holder can be told about them
+    if (dms_ctx->config.coherence == DMS_COHERENCE_RELEASE) {
+        int result = rc_flush_diffs();
+        if (result != DMS_SUCCESS) {
+            return result;
+        }
+    }
+
+    dms_message_t unlock;
+    memset(&unlock, 0, offsetof(dms_message_t, data));
+    unlock.type = MSG_UNLOCK;
+    unlock.block_id = id;
+    rc_pack_notices(&unlock);
+
+    int result = send_message(lock_home(id), &unlock);
+    if (result != DMS_SUCCESS) {
+        return result;
+    }
+
+    // Waiters must not depend on our next call into the library
+    return transport_flush();
+}
+
+// Process 0 side of MSG_BARRIER_ENTER
+int handle_barrier_enter(dms_message_t *msg) {
+    dms_sync_state_t *sync = dms_ctx->sync;
+
+    if (sync->barrier_notices) {
+        int count = msg->size / (int)sizeof(int32_t);
+        if (msg->position || sync->barrier_num_notices + count > NOTICES_PER_MESSAGE) {
+            sync->barrier_overflow = 1;
+        } else {
+            memcpy(sync->barrier_notices + sync->barrier_num_notices, msg->data, msg->size);
+            sync->barrier_num_notices += count;
+        }
+    }
+
+    sync->barrier_arrived++;
+    if (sync->barrier_arrived < dms_ctx->config.n) {
+        return DMS_SUCCESS;
+    }
+
+    dms_message_t release;
+    memset(&release, 0, offsetof(dms_message_t, data));
+    release.type = MSG_BARRIER_RELEASE;
+    release.block_id = msg->block_id;
+    release.position = sync->barrier_overflow;
+    release.size = 0;
+    if (!sync->barrier_overflow && sync->barrier_num_notices > 0) {
+        release.size = sync->barrier_num_notices * (int)sizeof(int32_t);
+        memcpy(release.data, sync->barrier_notices, release.size);
+    }
+
+    sync->barrier_arrived = 0;
+    sync->barrier_num_notices = 0;
+    sync->barrier_overflow = 0;
+
+    int result = DMS_SUCCESS;
+    for (int pid = 0; pid < dms_ctx->config.n; pid++) {
+        if (send_message(pid, &release) != DMS_SUCCESS) {
+            result = DMS_ERROR_COMMUNICATION;
+        }
+    }
+    return result;
+}
+
+int dms_barrier(void) {
+    if (!dms_ctx) {
+        return DMS_ERROR_COMMUNICATION;
+    }
+
+    if (dms_ctx->config.coherence == DMS_COHERENCE_RELEASE) {
+        int result = rc_flush_diffs();
+        if (result != DMS_SUCCESS) {
+            return result;
+        }
+    }
+
+    int epoch = dms_ctx->sync->barrier_epoch++;
+
+    dms_message_t enter;
+    memset(&enter, 0, offsetof(dms_message_t, data));
+    enter.type = MSG_BARRIER_ENTER;
+    enter.block_id = epoch;
+    rc_pack_notices(&enter);
+
+    int result = send_message(0, &enter);
+    if (result != DMS_SUCCESS) {
+        return result;
+    }
+
+    dms_message_t release;
+    result = wait_for_message_timeout(MSG_BARRIER_RELEASE, epoch, &release, -1);
+    if (result != DMS_SUCCESS) {
+        return result;
+    }
+
+    DMS_DEBUG("DEBUG: Process %d passed barrier %d\n", dms_ctx->mpi_rank, epoch);
+
+    return rc_apply_notices(&release);
+}
@@ -0,0 +1,336 @@
+#define _GNU_SOURCE
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "dms.h"
+
+// MPI backend. A receive for the largest possible message is kept posted
+// with MPI_Irecv so that incoming eager messages land without the
+// MPI_Iprobe/MPI_Get_count/MPI_Recv sequence on every poll.
+
+static int mpi_send(int target_pid, const void *buf, size_t nbytes) {
+    pthread_mutex_lock(&dms_ctx->mpi_mutex);
+    int result = MPI_Send(buf, (int)nbytes, MPI_BYTE, target_pid, 0, MPI_COMM_WORLD);
+    pthread_mutex_unlock(&dms_ctx->mpi_mutex);
+
+    return result == MPI_SUCCESS ? DMS_SUCCESS : DMS_ERROR_COMMUNICATION;
+}
+
+static int mpi_post_receive(void) {
+    dms_transport_state_t *transport = dms_ctx->transport;
+    if (transport->recv_posted) {
+        return DMS_SUCCESS;
+    }
+
+    pthread_mutex_lock(&dms_ctx->mpi_mutex);
+    int result = MPI_Irecv(transport->recv_buffer, sizeof(dms_message_t), MPI_BYTE,
+                           MPI_ANY_SOURCE, 0, MPI_COMM_WORLD, &transport->recv_request);
+    pthread_mutex_unlock(&dms_ctx->mpi_mutex);
+
+    if (result != MPI_SUCCESS) {
+        return DMS_ERROR_COMMUNICATION;
+    }
+    transport->recv_posted = 1;
+    return DMS_SUCCESS;
+}
+
+static int mpi_progress(void *buf, size_t capacity, size_t *nbytes) {
+    dms_transport_state_t *transport = dms_ctx->transport;
+    if (!transport->recv_posted) {
+        return DMS_ERROR_COMMUNICATION;
+    }
+
+    MPI_Status status;
+    int flag = 0;
+
+    pthread_mutex_lock(&dms_ctx->mpi_mutex);
+    int result = MPI_Test(&transport->recv_request, &flag, &status);
+    pthread_mutex_unlock(&dms_ctx->mpi_mutex);
+
+    if (result != MPI_SUCCESS || !flag) {
+        return DMS_ERROR_COMMUNICATION;
+    }
+
+    int count;
+    MPI_Get_count(&status, MPI_BYTE, &count);
+    transport->recv_posted = 0;
+
+    if ((size_t)count > capacity) {
+        return DMS_ERROR_COMMUNICATION;
+    }
+    memcpy(buf, transport->recv_buffer, count);
+    *nbytes = count;
+
+    return DMS_SUCCESS;
+}
+
+static int mpi_wait(int timeout_us) {
+    usleep(timeout_us);
+    return DMS_SUCCESS;
+}
+
+static void mpi_finalize(void) {
+    dms_transport_state_t *transport = dms_ctx->transport;
+    if (transport->recv_posted) {
+        pthread_mutex_lock(&dms_ctx->mpi_mutex);
+        MPI_Cancel(&transport->recv_request);
+        MPI_Wait(&transport->recv_request, MPI_STATUS_IGNORE);
+        pthread_mutex_unlock(&dms_ctx->mpi_mutex);
+        transport->recv_posted = 0;
+    }
+}
+
+const dms_transport_ops_t mpi_transport_ops = {
+    .name = "mpi",
+    .send = mpi_send,
+    .post_receive = mpi_post_receive,
+    .progress = mpi_progress,
+    .wait = mpi_wait,
+    .finalize = mpi_finalize,
+};
+
+// Message aggregation. Messages with a small payload (requests,
+// invalidations, acknowledgements, short writes) are packed per destination
+// into one MSG_BATCH. A destination's batch is sent when the next message
+// would exceed the threshold, when its oldest message has waited
+// DMS_BATCH_WINDOW_US, before a large message to the same destination (so
+// per-destination order is kept), and whenever a receive finds nothing,
+// i.e. before the caller waits.
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + ts.tv_nsec / 1000;
+}
+
+static int flush_outbox(int target_pid) {
+    dms_transport_state_t *transport = dms_ctx->transport;
+    int count = transport->outbox_count[target_pid];
+    if (count == 0) {
+        return DMS_SUCCESS;
+    }
+
+    dms_message_t *batch = transport->outbox[target_pid];
+    int result;
+    if (count == 1) {
+        // Nothing to aggregate with, send the message as it is
+        result = transport->ops->send(target_pid, batch->data, batch->size);
+    } else {
+        batch->type = MSG_BATCH;
+        batch->source_pid = dms_ctx->mpi_rank;
+        batch->target_pid = target_pid;
+        result = transport->ops->send(target_pid, batch, dms_message_size(batch));
+        DMS_DEBUG("DEBUG: Process %d sent %d messages to process %d in one batch\n",
+                  dms_ctx->mpi_rank, count, target_pid);
+    }
+
+    batch->size = 0;
+    transport->outbox_count[target_pid] = 0;
+    for (int i = 0; i < transport->num_pending; i++) {
+        if (transport->pending[i] == target_pid) {
+            transport->pending[i] = transport->pending[--transport->num_pending];
+            break;
+        }
+    }
+    return result;
+}
+
+static void flush_expired(void) {
+    dms_transport_state_t *transport = dms_ctx->transport;
+    if (transport->num_pending == 0) {
+        return;
+    }
+
+    uint64_t now = now_us();
+    int i = 0;
+    while (i < transport->num_pending) {
+        int target_pid = transport->pending[i];
+        if (now - transport->outbox_since[target_pid] >= DMS_BATCH_WINDOW_US) {
+            flush_outbox(target_pid);  // moves the last pending destination to i
+        } else {
+            i++;
+        }
+    }
+}
+
+int transport_flush(void) {
+    if (!dms_ctx || !dms_ctx->transport || !dms_ctx->transport->outbox) {
+        return DMS_SUCCESS;
+    }
+
+    dms_transport_state_t *transport = dms_ctx->transport;
+    int result = DMS_SUCCESS;
+    while (transport->num_pending > 0) {
+        if (flush_outbox(transport->pending[transport->num_pending - 1]) != DMS_SUCCESS) {
+            result = DMS_ERROR_COMMUNICATION;
+        }
+    }
+    return result;
+}
+
+int transport_send(int target_pid, const dms_message_t *msg) {
+    dms_transport_state_t *transport = dms_ctx->transport;
+    size_t nbytes = dms_message_size(msg);
+
+    if (!transport->outbox || msg->size > DMS_BATCH_MAX_PAYLOAD) {
+        if (transport->outbox && flush_outbox(target_pid) != DMS_SUCCESS) {
+            return DMS_ERROR_COMMUNICATION;
+        }
+        return transport->ops->send(target_pid, msg, nbytes);
+    }
+
+    dms_message_t *batch = transport->outbox[target_pid];
+    if (!batch) {
+        // Only destinations we actually talk to get a buffer
+        batch = malloc(offsetof(dms_message_t, data) + dms_ctx->config.batch);
+        if (!batch) {
+            return transport->ops->send(target_pid, msg, nbytes);
+        }
+        batch->size = 0;
+        transport->outbox[target_pid] = batch;
+    }
+    if (batch->size + nbytes > (size_t)dms_ctx->config.batch &&
+        flush_outbox(target_pid) != DMS_SUCCESS) {
+        return DMS_ERROR_COMMUNICATION;
+    }
+
+    if (transport->outbox_count[target_pid] == 0) {
+        transport->outbox_since[target_pid] = now_us();
+        transport->pending[transport->num_pending++] = target_pid;
+    }
+    memcpy(batch->data + batch->size, msg, nbytes);
+    batch->size += nbytes;
+    transport->outbox_count[target_pid]++;
+
+    return DMS_SUCCESS;
+}
+
+// Packed messages are not aligned inside the batch, hence the memcpy
+static void unpack_next(dms_message_t *msg) {
+    dms_transport_state_t *transport = dms_ctx->transport;
+    const byte *packed = transport->inbox->data + transport->inbox_offset;
+
+    memcpy(msg, packed, offsetof(dms_message_t, data));
+    memcpy(msg->data, packed + offsetof(dms_message_t, data), msg->size);
+    transport->inbox_offset += dms_message_size(msg);
+}
+
+int transport_receive(dms_message_t *msg) {
+    dms_transport_state_t *transport = dms_ctx->transport;
+
+    if (transport->inbox && transport->inbox_offset < transport->inbox->size) {
+        unpack_next(msg);
+        return DMS_SUCCESS;
+    }
+
+    if (transport->ops->post_receive() != DMS_SUCCESS) {
+        return DMS_ERROR_COMMUNICATION;
+    }
+
+    size_t nbytes;
+    if (transport->ops->progress(msg, sizeof(dms_message_t), &nbytes) != DMS_SUCCESS) {
+        // Nothing to do: the caller is about to wait, so nothing may stay queued
+        transport_flush();
+        return DMS_ERROR_COMMUNICATION;
+    }
+
+    if (transport->outbox) {
+        flush_expired();
+    }
+
+    if (msg->type == MSG_BATCH) {
+        if (!transport->inbox) {
+            return DMS_ERROR_COMMUNICATION;
+        }
+        memcpy(transport->inbox, msg, nbytes);
+        transport->inbox_offset = 0;
+        unpack_next(msg);
+    }
+
+    return DMS_SUCCESS;
+}
+
+static void free_transport(dms_transport_state_t *transport) {
+    free(transport->recv_buffer);
+    if (transport->outbox) {
+        for (int i = 0; i < dms_ctx->config.n; i++) {
+            free(transport->outbox[i]);
+        }
+    }
+    free(transport->outbox);
+    free(transport->pending);
+    free(transport->outbox_count);
+    free(transport->outbox_since);
+    free(transport->inbox);
+    free(transport);
+}
+
+int transport_init(void) {
+    if (!dms_ctx) {
+        return DMS_ERROR_COMMUNICATION;
+    }
+
+    dms_transport_state_t *transport = calloc(1, sizeof(dms_transport_state_t));
+    if (!transport) {
+        return DMS_ERROR_MEMORY;
+    }
+
+    if (dms_ctx->config.transport == DMS_TRANSPORT_LOOPBACK) {
+        transport->ops = &loopback_transport_ops;
+    } else {
+        transport->ops = &mpi_transport_ops;
+        transport->recv_buffer = malloc(sizeof(dms_message_t));
+        if (!transport->recv_buffer) {
+            free_transport(transport);
+            return DMS_ERROR_MEMORY;
+        }
+    }
+
+    // Every process allocates the inbox so that it can unpack batches even
+    // if its own aggregation is off
+    transport->inbox = malloc(sizeof(dms_message_t));
+    if (!transport->inbox) {
+        free_transport(transport);
+        return DMS_ERROR_MEMORY;
+    }
+
+    int n = dms_ctx->config.n;
+    if (dms_ctx->config.batch > MAX_BLOCK_SIZE) {
+        dms_ctx->config.batch = MAX_BLOCK_SIZE;
+    }
+    if (dms_ctx->config.batch > 0) {
+        transport->outbox = calloc(n, sizeof(dms_message_t *));
+        transport->outbox_count = calloc(n, sizeof(int));
+        transport->outbox_since = calloc(n, sizeof(uint64_t));
+        transport->pending = malloc(n * sizeof(int));
+        if (!transport->outbox || !transport->outbox_count || !transport->outbox_since ||
+            !transport->pending) {
+            free_transport(transport);
+            return DMS_ERROR_MEMORY;
+        }
+    }
+
+    dms_ctx->transport = transport;
+    return DMS_SUCCESS;
+}
+
+void transport_cleanup(void) {
+    if (!dms_ctx || !dms_ctx->transport) return;
+
+    transport_flush();
+    dms_ctx->transport->ops->finalize();
+
+    while (dms_ctx->deferred) {
+        deferred_message_t *next = dms_ctx->deferred->next;
+        free(dms_ctx->deferred);
+        dms_ctx->deferred = next;
+    }
+
+    free_transport(dms_ctx->transport);
+    dms_ctx->transport = NULL;
+}
@@ -0,0 +1,260 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dms.h"
+
+// Vectored le() / escreve() over many (position, buffer, length) elements.
+// Elements are taken in windows of up to VECTOR_WINDOW blocks that are not
+// cached yet; the window is sorted and deduplicated, one read request per
+// block is sent to every owner before any response is awaited (aggregation
+// packs the requests to the same owner into one MSG_BATCH), and then the
+// window's elements are served from the cache by le() / escreve(). The
+// window stays well below CACHE_SIZE so that its blocks are still cached
+// when the elements are copied.
+//
+// Under strict coherence remote writes do not need the block: escreve_v()
+// sends the MSG_WRITE_REQUESTs of a window back to back and only then
+// collects the acknowledgements. Owned, node-local (-s) and one-sided (RMA)
+// accesses never wait for a remote round trip and simply go through the
+// scalar calls.
+
+#define VECTOR_WINDOW (CACHE_SIZE / 2)  // blocks fetched or writes in flight at once
+
+typedef struct {
+    int block_id;
+    uint64_t sectors;
+} block_fetch_t;
+
+typedef struct {
+    int block_id;
+    int offset;
+    int size;
+} pending_write_t;
+
+typedef int (*scalar_op_t)(int posicao, byte *buffer, int tamanho);
+
+static int check_element(const dms_iovec_t *element) {
+    if (!element->buffer || element->posicao < 0 || element->tamanho <= 0) {
+        return DMS_ERROR_INVALID_POSITION;
+    }
+    int64_t total_memory_size = (int64_t)dms_ctx->config.k * dms_ctx->config.t;
+    if ((int64_t)element->posicao + element->tamanho > total_memory_size) {
+        return DMS_ERROR_INVALID_SIZE;
+    }
+    return DMS_SUCCESS;
+}
+
+// Blocks that le() would have to request with a message
+static int needs_message(int block_id, int owner) {
+    if (owner == dms_ctx->config.process_id || dms_ctx->config.transport == DMS_TRANSPORT_RMA) {
+        return 0;
+    }
+    if (dms_ctx->shm_peer_blocks && shm_is_node_local(owner)) {
+        return 0;
+    }
+    return !(dms_ctx->num_readonly_regions > 0 && get_replica_block_data(block_id));
+}
+
+static int add_missing(block_fetch_t *window, int count, int block_id, uint64_t needed) {
+    cache_entry_t *entry = find_cache_entry(block_id);
+    uint64_t missing = needed & ~(entry ? entry->sectors : 0);
+    if (!missing) {
+        return count;
+    }
+    for (int i = 0; i < count; i++) {
+        if (window[i].block_id == block_id) {
+            window[i].sectors |= missing;
+            return count;
+        }
+    }
+    window[count].block_id = block_id;
+    window[count].sectors = missing;
+    return count + 1;
+}
+
+// Adds the element's uncached blocks; the blocks of an element that do not
+// fit are left to the scalar call
+static int add_element(const dms_iovec_t *element, block_fetch_t *window, int count) {
+    int position = element->posicao;
+    int end = element->posicao + element->tamanho;
+    while (position < end && count < VECTOR_WINDOW) {
+        int block_id = dms_block_of(position);
+        int offset = dms_offset_of(position);
+        int size = dms_ctx->config.t - offset;
+        if (size > end - position) {
+            size = end - position;
+        }
+        if (needs_message(block_id, dms_owner_of(block_id))) {
+            count = add_missing(window, count, block_id, get_sector_mask(offset, size));
+        }
+        position += size;
+    }
+    return count;
+}
+
+static int compare_fetch(const void *a, const void *b) {
+    const block_fetch_t *x = a;
+    const block_fetch_t *y = b;
+    return (x->block_id > y->block_id) - (x->block_id < y->block_id);
+}
+
+static int fetch_window(block_fetch_t *window, int count) {
+    qsort(window, count, sizeof(block_fetch_t), compare_fetch);
+
+    int result = DMS_SUCCESS;
+    int sent = 0;
+    while (sent < count) {
+        result = send_read_request(window[sent].block_id, dms_owner_of(window[sent].block_id),
+                                   window[sent].sectors);
+        if (result != DMS_SUCCESS) {
+            break;
+        }
+        sent++;
+    }
+
+    DMS_DEBUG("DEBUG: Process %d requested %d blocks for a vectored access\n",
+              dms_ctx->mpi_rank, sent);
+
+    // Responses of the requests that went out are collected even after an error
+    for (int i = 0; i < sent; i++) {
+        int received = receive_read_response(window[i].block_id, window[i].sectors);
+        if (received != DMS_SUCCESS && result == DMS_SUCCESS) {
+            result = received;
+        }
+    }
+    return result;
+}
+
+static int run_windows(const dms_iovec_t *elementos, int quantidade, scalar_op_t op) {
+    block_fetch_t window[VECTOR_WINDOW];
+    int first = 0;
+    while (first < quantidade) {
+        int count = 0;
+        int end = first;
+        while (end < quantidade && count < VECTOR_WINDOW) {
+            count = add_element(&elementos[end], window, count);
+            end++;
+        }
+
+        int result = fetch_window(window, count);
+        if (result != DMS_SUCCESS) {
+            return result;
+        }
+
+        for (int i = first; i < end; i++) {
+            result = op(elementos[i].posicao, elementos[i].buffer, elementos[i].tamanho);
+            if (result != DMS_SUCCESS) {
+                return result;
+            }
+        }
+        first = end;
+    }
+    return DMS_SUCCESS;
+}
+
+int le_v(const dms_iovec_t *elementos, int quantidade) {
+    if (!dms_ctx || !elementos || quantidade < 0) {
+        return DMS_ERROR_INVALID_POSITION;
+    }
+    for (int i = 0; i < quantidade; i++) {
+        int result = check_element(&elementos[i]);
+        if (result != DMS_SUCCESS) {
+            return result;
+        }
+    }
+
+    return run_windows(elementos, quantidade, le);
+}
+
+static int complete_writes(const pending_write_t *pending, int count) {
+    int result = DMS_SUCCESS;
+    for (int i = 0; i < count; i++) {
+        dms_message_t response;
+        int received = wait_for_message(MSG_WRITE_RESPONSE, pending[i].block_id, &response);
+        if (received != DMS_SUCCESS) {
+            if (result == DMS_SUCCESS) {
+                result = received;
+            }
+            continue;
+        }
+        drop_written_sectors(pending[i].block_id, pending[i].offset, pending[i].size);
+    }
+    return result;
+}
+
+// Strict coherence: remote chunks become MSG_WRITE_REQUESTs in flight, the
+// others go through escreve()
+static int write_pipelined(const dms_iovec_t *elementos, int quantidade) {
+    pending_write_t pending[VECTOR_WINDOW];
+    int num_pending = 0;
+
+    for (int i = 0; i < quantidade; i++) {
+        const dms_iovec_t *element = &elementos[i];
+        int done = 0;
+        while (done < element->tamanho) {
+            int position = element->posicao + done;
+            int block_id = dms_block_of(position);
+            int offset = dms_offset_of(position);
+            int owner = dms_owner_of(block_id);
+            int size = dms_ctx->config.t - offset;
+            if (size > element->tamanho - done) {
+                size = element->tamanho - done;
+            }
+
+            int result;
+            if (needs_message(block_id, owner)) {
+                dms_message_t request;
+                memset(&request, 0, offsetof(dms_message_t, data));
+                request.type = MSG_WRITE_REQUEST;
+                request.block_id = block_id;
+                request.position = offset;
+                request.size = size;
+                memcpy(request.data, element->buffer + done, size);
+
+                result = send_message(owner, &request);
+                if (result == DMS_SUCCESS) {
+                    pending[num_pending].block_id = block_id;
+                    pending[num_pending].offset = offset;
+                    pending[num_pending].size = size;
+                    if (++num_pending == VECTOR_WINDOW) {
+                        result = complete_writes(pending, num_pending);
+                        num_pending = 0;
+                    }
+                }
+            } else {
+                result = escreve(position, element->buffer + done, size);
+            }
+
+            if (result != DMS_SUCCESS) {
+                complete_writes(pending, num_pending);
+                return result;
+            }
+            done += size;
+        }
+    }
+
+    return complete_writes(pending, num_pending);
+}
+
+int escreve_v(const dms_iovec_t *elementos, int quantidade) {
+    if (!dms_ctx || !elementos || quantidade < 0) {
+        return DMS_ERROR_INVALID_POSITION;
+    }
+    for (int i = 0; i < quantidade; i++) {
+        int result = check_element(&elementos[i]);
+        if (result != DMS_SUCCESS) {
+            return result;
+        }
+        if (is_readonly_range(elementos[i].posicao, elementos[i].tamanho)) {
+            return DMS_ERROR_READONLY;
+        }
+    }
+
+    // Release consistency writes into the cached block, which needs the
+    // written sectors first
+    if (dms_ctx->config.coherence == DMS_COHERENCE_RELEASE) {
+        return run_windows(elementos, quantidade, escreve);
+    }
+    return write_pipelined(elementos, quantidade);
+}
@@ -1,5 +1,6 @@
 #include <pthread.h>
 #include <signal.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -178,7 +179,9 @@ void test_cache_invalidation_scenario(void) {
 
     // Verify cache entry exists after first read
     cache_entry_t *cache_entry = find_cache_entry(remote_block);
-    if (cache_entry && cache_entry->valid) {
+    if (shm_is_node_local(owner_process)) {
+        printf("TEST: Block %d read directly from node shared memory\n", remote_block);
+    } else if (cache_entry && cache_entry->valid) {
         printf("TEST: Block %d now cached in process 0\n", remote_block);
     } else {
         printf("Error: Cache entry not found or invalid after read\n");
@@ -214,6 +217,532 @@ void test_cache_invalidation_scenario(void) {
     }
 }
 
+void test_atomic_operations(void) {
+    printf("\n=== Testing Atomic Operations ===\n");
+
+    // Use a remote block at the end of the memory, away from the other tests
+    int remote_block = dms_ctx->config.k - 1;
+    if (get_block_owner(remote_block) == dms_ctx->config.process_id) {
+        remote_block--;
+    }
+    // Deliberately unaligned: atomics work at any position inside a block
+    int position = remote_block * dms_ctx->config.t + 3;
+    int64_t previous;
+    int failures = 0;
+
+    printf("TEST: Atomics on block %d (owner=%d) at position %d\n",
+           remote_block, get_block_owner(remote_block), position);
+
+    if (dms_swap(position, 8, 100, &previous) != DMS_SUCCESS) failures++;
+
+    if (dms_fetch_add(position, 8, 5, &previous) != DMS_SUCCESS || previous != 100) {
+        printf("Error: fetch_add returned %lld, expected 100\n", (long long)previous);
+        failures++;
+    }
+
+    if (dms_cas(position, 8, 105, 7, &previous) != DMS_SUCCESS || previous != 105) {
+        printf("Error: successful cas returned %lld, expected 105\n", (long long)previous);
+        failures++;
+    }
+
+    if (dms_cas(position, 8, 105, 9, &previous) != DMS_SUCCESS || previous != 7) {
+        printf("Error: failed cas returned %lld, expected 7\n", (long long)previous);
+        failures++;
+    }
+
+    int64_t value = 0;
+    if (le(position, (byte *)&value, sizeof(value)) != DMS_SUCCESS || value != 7) {
+        printf("Error: read %lld after atomics, expected 7\n", (long long)value);
+        failures++;
+    }
+
+    // 32-bit values wrap around
+    int32_t narrow = INT32_MAX;
+    escreve(position + 8, (byte *)&narrow, sizeof(narrow));
+    if (dms_fetch_add(position + 8, 4, 1, &previous) != DMS_SUCCESS || previous != INT32_MAX ||
+        le(position + 8, (byte *)&narrow, sizeof(narrow)) != DMS_SUCCESS || narrow != INT32_MIN) {
+        printf("Error: 32-bit fetch_add did not wrap around\n");
+        failures++;
+    }
+
+    // Values straddling two blocks are rejected
+    int straddling = (remote_block + 1) * dms_ctx->config.t - 4;
+    if (remote_block + 1 < dms_ctx->config.k &&
+        dms_fetch_add(straddling, 8, 1, NULL) != DMS_ERROR_INVALID_POSITION) {
+        printf("Error: atomic across a block boundary was accepted\n");
+        failures++;
+    }
+
+    if (failures == 0) {
+        printf("✓ Atomic operations test PASSED\n");
+    } else {
+        printf("✗ Atomic operations test FAILED\n");
+    }
+}
+
+void test_release_consistency(void) {
+    printf("\n=== Testing Release Consistency ===\n");
+
+    // Two disjoint writes to the same remote block stay in our cached copy
+    // until dms_release() ships them to the owner as one diff
+    int remote_block = dms_ctx->config.k - 3;
+    if (get_block_owner(remote_block) == dms_ctx->config.process_id) {
+        remote_block--;
+    }
+    int position = remote_block * dms_ctx->config.t;
+
+    const char *head = "RELEASE";
+    const char *tail = "CONSISTENCY";
+    int tail_offset = dms_ctx->config.t / 2;
+    byte buffer[64];
+    int failures = 0;
+
+    dms_acquire();
+    if (escreve(position, (byte *)head, strlen(head)) != DMS_SUCCESS ||
+        escreve(position + tail_offset, (byte *)tail, strlen(tail)) != DMS_SUCCESS) {
+        printf("Error: writes to block %d failed\n", remote_block);
+        failures++;
+    }
+
+    cache_entry_t *entry = find_cache_entry(remote_block);
+    printf("TEST: Block %d has unreleased writes: %s\n", remote_block,
+           entry && entry->dirty ? "yes" : "no");
+    if (!entry || !entry->dirty) {
+        failures++;
+    }
+
+    if (dms_release() != DMS_SUCCESS) {
+        printf("Error: release failed\n");
+        failures++;
+    }
+
+    // Re-read from the owner, not from our cached copy
+    dms_flush_local_cache();
+    memset(buffer, 0, sizeof(buffer));
+    le(position, buffer, strlen(head));
+    if (memcmp(buffer, head, strlen(head)) != 0) failures++;
+    memset(buffer, 0, sizeof(buffer));
+    le(position + tail_offset, buffer, strlen(tail));
+    if (memcmp(buffer, tail, strlen(tail)) != 0) failures++;
+
+    if (failures == 0) {
+        printf("✓ Release consistency test PASSED\n");
+    } else {
+        printf("✗ Release consistency test FAILED\n");
+    }
+}
+
+void test_locks(void) {
+    printf("\n=== Testing Locks ===\n");
+
+    // Lock 1 lives on process 1 (when there is one), lock 0 on ourselves
+    int remote_lock = 1;
+    int remote_block = dms_ctx->config.k - 5;
+    if (get_block_owner(remote_block) == dms_ctx->config.process_id) {
+        remote_block--;
+    }
+    int position = remote_block * dms_ctx->config.t;
+
+    const char *message = "LOCKED";
+    byte buffer[16];
+    int failures = 0;
+
+    if (dms_lock(remote_lock) != DMS_SUCCESS || dms_lock(0) != DMS_SUCCESS) {
+        printf("Error: lock acquisition failed\n");
+        failures++;
+    }
+    if (escreve(position, (byte *)message, strlen(message)) != DMS_SUCCESS) {
+        failures++;
+    }
+    if (dms_unlock(0) != DMS_SUCCESS || dms_unlock(remote_lock) != DMS_SUCCESS) {
+        printf("Error: unlock failed\n");
+        failures++;
+    }
+
+    // The home only grants again after it processed our unlock, and under
+    // release consistency the unlock has written the block back
+    if (dms_lock(remote_lock) != DMS_SUCCESS) {
+        failures++;
+    }
+    dms_flush_local_cache();
+    memset(buffer, 0, sizeof(buffer));
+    le(position, buffer, strlen(message));
+    printf("TEST: Read '%s' from block %d under lock %d\n", (char *)buffer, remote_block, remote_lock);
+    if (memcmp(buffer, message, strlen(message)) != 0) failures++;
+    if (dms_unlock(remote_lock) != DMS_SUCCESS) failures++;
+
+    if (dms_lock(-1) == DMS_SUCCESS) {
+        printf("Error: negative lock id accepted\n");
+        failures++;
+    }
+
+    if (failures == 0) {
+        printf("✓ Lock test PASSED\n");
+    } else {
+        printf("✗ Lock test FAILED\n");
+    }
+}
+
+void test_sectored_cache(void) {
+    printf("\n=== Testing Sectored Cache ===\n");
+
+    int sector = dms_ctx->config.sector;
+    int remote_block = dms_ctx->config.k - 6;
+    if (get_block_owner(remote_block) == dms_ctx->config.process_id) {
+        remote_block--;
+    }
+    int position = remote_block * dms_ctx->config.t;
+    int last_sector = dms_ctx->config.t - sector;
+
+    byte buffer[32];
+    int failures = 0;
+
+    // A small read fetches only the sector it touches
+    le(position, buffer, sizeof(buffer));
+    cache_entry_t *entry = find_cache_entry(remote_block);
+    int cached = entry ? __builtin_popcountll(entry->sectors) : 0;
+    printf("TEST: %d of %d sectors cached after a %zu-byte read\n", cached,
+           dms_ctx->config.t / sector, sizeof(buffer));
+    if (cached != 1) failures++;
+
+    le(position + last_sector, buffer, sizeof(buffer));
+    entry = find_cache_entry(remote_block);
+    if (!entry || __builtin_popcountll(entry->sectors) != 2) failures++;
+
+    // Writing the first sector leaves the last one cached
+    const char *message = "SECTOR";
+    if (escreve(position, (byte *)message, strlen(message)) != DMS_SUCCESS) failures++;
+    dms_release();
+    entry = find_cache_entry(remote_block);
+    if (dms_ctx->config.coherence == DMS_COHERENCE_STRICT) {
+        uint64_t last_bit = (uint64_t)1 << (last_sector / sector);
+        printf("TEST: Last sector still cached after write: %s\n",
+               entry && (entry->sectors & last_bit) ? "yes" : "no");
+        if (!entry || entry->sectors != last_bit) failures++;
+    }
+
+    dms_flush_local_cache();
+    memset(buffer, 0, sizeof(buffer));
+    le(position, buffer, strlen(message));
+    if (memcmp(buffer, message, strlen(message)) != 0) failures++;
+
+    if (failures == 0) {
+        printf("✓ Sectored cache test PASSED\n");
+    } else {
+        printf("✗ Sectored cache test FAILED\n");
+    }
+}
+
+void test_mapped_memory(void) {
+    printf("\n=== Testing Mapped Memory ===\n");
+
+    byte *base = NULL;
+    if (dms_map(&base) != DMS_SUCCESS) {
+        printf("✗ Mapped memory test FAILED (dms_map)\n");
+        return;
+    }
+
+    int t = dms_ctx->config.t;
+    int owned_block = dms_ctx->config.k - 8;
+    while (get_block_owner(owned_block) != dms_ctx->config.process_id) {
+        owned_block++;
+    }
+    int remote_block = dms_ctx->config.k - 7;
+    if (get_block_owner(remote_block) == dms_ctx->config.process_id) {
+        remote_block--;
+    }
+
+    byte buffer[16];
+    int failures = 0;
+
+    // Owned blocks are the same memory through both interfaces
+    const char *local_message = "OWNED";
+    escreve(owned_block * t, (byte *)local_message, strlen(local_message));
+    char *owned = (char *)base + (size_t)owned_block * t;
+    int matches = memcmp(owned, local_message, strlen(local_message)) == 0;
+    printf("TEST: Pointer read of owned block %d: %s\n", owned_block, matches ? "matches" : "differs");
+    if (!matches) failures++;
+
+    owned[8] = 'P';
+    le(owned_block * t + 8, buffer, 1);
+    if (buffer[0] != 'P') failures++;
+
+    // A remote block is fetched on the first load and written back at the release
+    const char *remote_message = "MAPPED";
+    const char *previous = "REMOTE";
+    escreve(remote_block * t, (byte *)previous, strlen(previous));
+    dms_release();
+    char *remote = (char *)base + (size_t)remote_block * t;
+    matches = memcmp(remote, previous, strlen(previous)) == 0;
+    printf("TEST: Pointer read of remote block %d: %s\n", remote_block, matches ? "matches" : "differs");
+    if (!matches) failures++;
+
+    memcpy(remote, remote_message, strlen(remote_message));
+    dms_release();
+    dms_flush_local_cache();
+    memset(buffer, 0, sizeof(buffer));
+    le(remote_block * t, buffer, strlen(remote_message));
+    printf("TEST: Read '%s' after pointer store and release\n", (char *)buffer);
+    if (memcmp(buffer, remote_message, strlen(remote_message)) != 0) failures++;
+
+    if (failures == 0) {
+        printf("✓ Mapped memory test PASSED\n");
+    } else {
+        printf("✗ Mapped memory test FAILED\n");
+    }
+}
+
+void test_vectored_access(void) {
+    printf("\n=== Testing Vectored Access ===\n");
+
+    enum { NUM_ELEMENTS = 8, ELEMENT_SIZE = 12 };
+    int t = dms_ctx->config.t;
+    int first_block = dms_ctx->config.k - 16;
+
+    // One element per block plus one that crosses into the first of them
+    char written[NUM_ELEMENTS + 1][ELEMENT_SIZE];
+    char read[NUM_ELEMENTS + 1][ELEMENT_SIZE];
+    dms_iovec_t writes[NUM_ELEMENTS + 1];
+    dms_iovec_t reads[NUM_ELEMENTS + 1];
+    for (int i = 0; i <= NUM_ELEMENTS; i++) {
+        snprintf(written[i], ELEMENT_SIZE, "VECTOR_%d", i);
+        int position = i < NUM_ELEMENTS ? (first_block + i) * t + 16 : first_block * t - ELEMENT_SIZE / 2;
+        writes[i] = (dms_iovec_t){position, (byte *)written[i], ELEMENT_SIZE};
+        reads[i] = (dms_iovec_t){position, (byte *)read[i], ELEMENT_SIZE};
+    }
+
+    int failures = 0;
+    printf("TEST: Writing %d elements across blocks %d-%d...\n", NUM_ELEMENTS + 1,
+           first_block - 1, first_block + NUM_ELEMENTS - 1);
+    if (escreve_v(writes, NUM_ELEMENTS + 1) != DMS_SUCCESS) failures++;
+    dms_release();
+
+    dms_flush_local_cache();
+    memset(read, 0, sizeof(read));
+    if (le_v(reads, NUM_ELEMENTS + 1) != DMS_SUCCESS) failures++;
+    int matches = memcmp(read, written, sizeof(read)) == 0;
+    printf("TEST: Gathered elements %s the written ones\n", matches ? "match" : "differ from");
+    if (!matches) failures++;
+
+    // The scalar calls see the same bytes
+    char scalar[ELEMENT_SIZE];
+    for (int i = 0; i <= NUM_ELEMENTS; i++) {
+        le(reads[i].posicao, (byte *)scalar, ELEMENT_SIZE);
+        if (memcmp(scalar, written[i], ELEMENT_SIZE) != 0) failures++;
+    }
+
+    if (failures == 0) {
+        printf("✓ Vectored access test PASSED\n");
+    } else {
+        printf("✗ Vectored access test FAILED\n");
+    }
+}
+
+// Example kernel for dms_register_kernel(): int32 elements greater than arg
+#define KERNEL_COUNT_ABOVE DMS_APPLY_FIRST_KERNEL
+
+static void scan_count_above(const byte *data, int posicao, int tamanho, int64_t arg, int64_t *acc) {
+    (void)posicao;
+    for (int i = 0; i < tamanho; i += 4) {
+        int32_t value;
+        memcpy(&value, data + i, sizeof(value));
+        *acc += value > arg;
+    }
+}
+
+static int64_t add_partials(int64_t a, int64_t b) {
+    return a + b;
+}
+
+void test_near_data_apply(void) {
+    printf("\n=== Testing Near-Data Apply ===\n");
+
+    enum { NUM_BLOCKS = 8 };
+    int t = dms_ctx->config.t;
+    int position = (dms_ctx->config.k - 24) * t;
+    int size = NUM_BLOCKS * t;
+    int count = size / 8;
+
+    int64_t *values = malloc(size);
+    int64_t sum = 0, min = INT64_MAX, max = INT64_MIN, above = 0;
+    for (int i = 0; i < count; i++) {
+        values[i] = (int64_t)i * 7 - 1000;
+        sum += values[i];
+        if (values[i] < min) min = values[i];
+        if (values[i] > max) max = values[i];
+    }
+    for (int i = 0; i < size / 4; i++) {
+        above += ((int32_t *)values)[i] > 0;
+    }
+    byte *hit = memchr(values, 0xAB, size);
+    int64_t first = hit ? position + (hit - (byte *)values) : -1;
+
+    int failures = 0;
+    printf("TEST: Writing %d int64 values over %d blocks...\n", count, NUM_BLOCKS);
+    if (escreve(position, (byte *)values, size) != DMS_SUCCESS) failures++;
+
+    // Unreleased writes reach the owners before they scan
+    int64_t result = 0;
+    if (dms_apply(position, size, DMS_APPLY_SUM, 0, &result) != DMS_SUCCESS || result != sum) failures++;
+    printf("TEST: Sum %lld (expected %lld)\n", (long long)result, (long long)sum);
+    if (dms_apply(position, size, DMS_APPLY_MIN, 0, &result) != DMS_SUCCESS || result != min) failures++;
+    if (dms_apply(position, size, DMS_APPLY_MAX, 0, &result) != DMS_SUCCESS || result != max) failures++;
+    if (dms_apply(position, size, DMS_APPLY_COUNT, values[5], &result) != DMS_SUCCESS || result != 1) failures++;
+    if (dms_apply(position, size, DMS_APPLY_FIND, 0xAB, &result) != DMS_SUCCESS || result != first) failures++;
+    printf("TEST: First byte 0xAB at %lld (expected %lld)\n", (long long)result, (long long)first);
+    if (dms_apply(position, size, KERNEL_COUNT_ABOVE, 0, &result) != DMS_SUCCESS || result != above) failures++;
+    printf("TEST: Registered kernel counted %lld (expected %lld)\n", (long long)result, (long long)above);
+
+    // Elements may not straddle blocks
+    if (dms_apply(position + 4, 8, DMS_APPLY_SUM, 0, &result) != DMS_ERROR_INVALID_SIZE) failures++;
+
+    free(values);
+    if (failures == 0) {
+        printf("✓ Near-data apply test PASSED\n");
+    } else {
+        printf("✗ Near-data apply test FAILED\n");
+    }
+}
+
+void test_bulk_copy(void) {
+    printf("\n=== Testing Bulk Copy and Fill ===\n");
+
+    int t = dms_ctx->config.t;
+    int source = (dms_ctx->config.k - 32) * t + 100;
+    int destination = (dms_ctx->config.k - 28) * t + 7;
+    int size = 3 * t - 50;
+    int margin = 10;
+
+    byte *pattern = malloc(size);
+    byte *buffer = malloc(size + 2 * margin);
+    for (int i = 0; i < size; i++) {
+        pattern[i] = (byte)(i * 13);
+    }
+
+    int failures = 0;
+    if (escreve(source, pattern, size) != DMS_SUCCESS) failures++;
+
+    printf("TEST: Filling %d bytes at %d...\n", size + 2 * margin, destination - margin);
+    if (dms_fill(destination - margin, 0x5A, size + 2 * margin) != DMS_SUCCESS) failures++;
+    le(destination - margin, buffer, size + 2 * margin);
+    int filled = 1;
+    for (int i = 0; i < size + 2 * margin; i++) {
+        filled &= buffer[i] == 0x5A;
+    }
+    if (!filled) failures++;
+
+    // The destination is cached now; the copy must invalidate it
+    printf("TEST: Copying %d bytes from %d to %d...\n", size, source, destination);
+    if (dms_copy(destination, source, size) != DMS_SUCCESS) failures++;
+    le(destination - margin, buffer, size + 2 * margin);
+    int matches = memcmp(buffer + margin, pattern, size) == 0;
+    printf("TEST: Copied bytes %s the source\n", matches ? "match" : "differ from");
+    if (!matches) failures++;
+    if (buffer[margin - 1] != 0x5A || buffer[margin + size] != 0x5A) failures++;
+
+    if (dms_copy(source + 8, source, size) != DMS_ERROR_INVALID_POSITION) failures++;
+
+    free(pattern);
+    free(buffer);
+    if (failures == 0) {
+        printf("✓ Bulk copy test PASSED\n");
+    } else {
+        printf("✗ Bulk copy test FAILED\n");
+    }
+}
+
+// Collective: every process runs it, process 0 checks and reports
+void test_checkpoint_load(void) {
+    int me = dms_ctx->config.process_id;
+    int n = dms_ctx->config.n;
+    int t = dms_ctx->config.t;
+    int first_block = dms_ctx->config.k - 40;
+    const char *path = "dms_test_checkpoint.bin";
+
+    if (me == 0) {
+        printf("\n=== Testing Checkpoint and Load ===\n");
+    }
+
+    // One marker per process, in a block it owns
+    char marker[24];
+    snprintf(marker, sizeof(marker), "SAVED_%d", me);
+    int own_block = first_block + ((me - first_block % n) + n) % n;
+    escreve(own_block * t, (byte *)marker, sizeof(marker));
+
+    int failures = 0;
+    if (dms_checkpoint(path) != DMS_SUCCESS) failures++;
+
+    // Overwritten after the checkpoint, restored by the load
+    escreve(own_block * t, (byte *)"CHANGED", 8);
+    if (dms_load(path) != DMS_SUCCESS) failures++;
+
+    if (me == 0) {
+        for (int pid = 0; pid < n; pid++) {
+            char expected[24], buffer[24];
+            snprintf(expected, sizeof(expected), "SAVED_%d", pid);
+            int block = first_block + ((pid - first_block % n) + n) % n;
+            le(block * t, (byte *)buffer, sizeof(buffer));
+            if (strcmp(buffer, expected) != 0) failures++;
+        }
+        printf("TEST: %d of %d markers restored from %s\n", failures == 0 ? n : 0, n, path);
+        unlink(path);
+
+        if (failures == 0) {
+            printf("✓ Checkpoint and load test PASSED\n");
+        } else {
+            printf("✗ Checkpoint and load test FAILED\n");
+        }
+    }
+}
+
+// Collective: every process caches a block of process 0, which then writes
+// it and another block nobody has read
+void test_sharer_directory(void) {
+    int me = dms_ctx->config.process_id;
+    int n = dms_ctx->config.n;
+    int t = dms_ctx->config.t;
+    int first_block = dms_ctx->config.k - 48;
+    int shared_block = first_block + ((0 - first_block % n) + n) % n;
+    int private_block = shared_block + n;
+
+    if (me == 0) {
+        printf("\n=== Testing Sharer Directory ===\n");
+    }
+
+    char buffer[16];
+    le(shared_block * t, (byte *)buffer, sizeof(buffer));
+    dms_barrier();
+
+    int failures = 0;
+    if (me == 0) {
+        // Nobody to invalidate: the owner knows no process read the block
+        uint64_t before = dms_ctx->invalidations_sent;
+        escreve(private_block * t, (byte *)"PRIVATE", 8);
+        printf("TEST: write to an unshared block sent %llu invalidations\n",
+               (unsigned long long)(dms_ctx->invalidations_sent - before));
+        if (dms_ctx->invalidations_sent != before) failures++;
+
+        escreve(shared_block * t, (byte *)"SHARED", 7);
+    }
+    dms_barrier();
+
+    le(shared_block * t, (byte *)buffer, 7);
+    if (strcmp(buffer, "SHARED") != 0) failures++;
+    dms_barrier();  // process 0 serves the reads until everybody is done
+
+    int total_failures = 0;
+    MPI_Reduce(&failures, &total_failures, 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
+    if (me == 0) {
+        printf("TEST: every cached copy of the shared block was invalidated: %s\n",
+               total_failures == 0 ? "yes" : "no");
+        if (total_failures == 0) {
+            printf("✓ Sharer directory test PASSED\n");
+        } else {
+            printf("✗ Sharer directory test FAILED\n");
+        }
+    }
+}
+
 int main(int argc, char *argv[]) {
     dms_config_t config;
     int result;
@@ -275,10 +804,23 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
+    // Kernels are registered under the same id in every process
+    dms_kernel_t count_above = {4, 0, scan_count_above, add_partials};
+    dms_register_kernel(KERNEL_COUNT_ABOVE, &count_above);
+
     // Synchronize all processes before starting tests
-    pthread_mutex_lock(&dms_ctx->mpi_mutex);
-    MPI_Barrier(MPI_COMM_WORLD);
-    pthread_mutex_unlock(&dms_ctx->mpi_mutex);
+    dms_barrier();
+
+    // Collective tests run on every process before the others start serving
+    if (config.process_id == 0) {
+        printf("\n--- TEST 0: CHECKPOINT AND LOAD (all processes) ---\n");
+    }
+    test_checkpoint_load();
+
+    if (config.process_id == 0) {
+        printf("\n--- TEST 0B: SHARER DIRECTORY (all processes) ---\n");
+    }
+    test_sharer_directory();
 
     // Run tests based on process ID
     if (config.process_id == 0) {
@@ -301,6 +843,45 @@ int main(int argc, char *argv[]) {
         dms_flush_local_cache();  // Isolate from previous test
         test_cache_invalidation_scenario();
 
+        printf("\n--- TEST 5: ATOMIC OPERATIONS ---\n");
+        dms_flush_local_cache();  // Isolate from previous test
+        test_atomic_operations();
+
+        if (config.coherence == DMS_COHERENCE_RELEASE) {
+            printf("\n--- TEST 6: RELEASE CONSISTENCY ---\n");
+            dms_flush_local_cache();  // Isolate from previous test
+            test_release_consistency();
+        }
+
+        printf("\n--- TEST 7: LOCKS ---\n");
+        dms_flush_local_cache();  // Isolate from previous test
+        test_locks();
+
+        // With -s node-local blocks are never cached
+        if (dms_ctx->config.sector < dms_ctx->config.t && !dms_ctx->config.shm) {
+            printf("\n--- TEST 8: SECTORED CACHE ---\n");
+            dms_flush_local_cache();  // Isolate from previous test
+            test_sectored_cache();
+        }
+
+        if (config.map) {
+            printf("\n--- TEST 9: MAPPED MEMORY ---\n");
+            dms_flush_local_cache();  // Isolate from previous test
+            test_mapped_memory();
+        }
+
+        printf("\n--- TEST 10: VECTORED ACCESS ---\n");
+        dms_flush_local_cache();  // Isolate from previous test
+        test_vectored_access();
+
+        printf("\n--- TEST 11: NEAR-DATA APPLY ---\n");
+        dms_flush_local_cache();  // Isolate from previous test
+        test_near_data_apply();
+
+        printf("\n--- TEST 12: BULK COPY ---\n");
+        dms_flush_local_cache();  // Isolate from previous test
+        test_bulk_copy();
+
         printf("\n--- ALL TESTS COMPLETED ---\n");
         printf("Process 0 tests finished, waiting for cleanup...\n");
     } else {